@@ -0,0 +1,265 @@
+#include "DistributionGen.hpp"
+#include "FineTimeMC.hpp"
+#include "MultiNomial.hpp"
+#include "Sinker.hpp"
+#include "UniformInserter.hpp"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <thread>
+
+const unsigned int SEED_NUM = 0;
+
+constexpr auto DISTRIBUTION = std::array<double, 3>{ 0.3, 0.1, 0.6 };
+
+// silences the progress messages of the writers while they are measured
+class MuteCout
+{
+  public:
+    MuteCout()
+        : old_buffer_{ std::cout.rdbuf(sink_.rdbuf()) }
+    {
+    }
+    ~MuteCout()
+    {
+        std::cout.rdbuf(old_buffer_);
+    }
+    MuteCout(const MuteCout&) = delete;
+    MuteCout(MuteCout&&) = delete;
+    auto operator=(const MuteCout&) -> MuteCout& = delete;
+    auto operator=(MuteCout&&) -> MuteCout& = delete;
+
+  private:
+    std::ostringstream sink_;
+    std::streambuf* old_buffer_ = nullptr;
+};
+
+// ----------------------------------------------------------------
+// building blocks
+
+static void BM_RandomFill(benchmark::State& state)
+{
+    auto engine = CounterEngine{ SEED_NUM, StreamKey(StreamTag::pa, 0) };
+    auto multinomial = MultiNomial{ &engine };
+    multinomial.SetEntryN(static_cast<unsigned int>(state.range(0)));
+    multinomial.SetDistribution(DISTRIBUTION);
+    auto entries = std::array<unsigned int, 3>{};
+    uint64_t sample = 0;
+    for (auto _ : state)
+    {
+        engine.SetSample(sample++);
+        multinomial.RandomFill(entries);
+        benchmark::DoNotOptimize(entries);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RandomFill)->Arg(10)->Arg(100)->Arg(1000)->Arg(100000);
+
+// general binomial chain used for distributions other than std::array<double, 3>
+static void BM_RandomFill_chain(benchmark::State& state)
+{
+    auto engine = CounterEngine{ SEED_NUM, StreamKey(StreamTag::pa, 0) };
+    auto multinomial = MultiNomial{ &engine };
+    multinomial.SetEntryN(static_cast<unsigned int>(state.range(0)));
+    const auto distribution = std::vector<double>(DISTRIBUTION.begin(), DISTRIBUTION.end());
+    uint64_t sample = 0;
+    for (auto _ : state)
+    {
+        engine.SetSample(sample++);
+        benchmark::DoNotOptimize(multinomial.RandomFill(distribution));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RandomFill_chain)->Arg(10)->Arg(100)->Arg(1000)->Arg(100000);
+
+static void BM_UniformInserter(benchmark::State& state)
+{
+    constexpr unsigned int entryN = 100;
+    auto inserter = UniformInserter{ entryN, static_cast<InserterMode>(state.range(0)) };
+    auto* engine = inserter.GetEngine();
+    engine->SetStream(StreamKey(StreamTag::pa, 0));
+    const auto entries = std::array<unsigned int, 3>{ 30, 10, 60 };
+    uint64_t sample = 0;
+    for (auto _ : state)
+    {
+        engine->SetSample(sample++);
+        inserter(entries);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(state.range(0) == static_cast<int>(InserterMode::histogram) ? "histogram" : "statistics");
+}
+BENCHMARK(BM_UniformInserter)
+    ->Arg(static_cast<int>(InserterMode::statistics))
+    ->Arg(static_cast<int>(InserterMode::histogram));
+
+static void BM_UniformInserter_batch(benchmark::State& state)
+{
+    constexpr unsigned int entryN = 100;
+    auto inserter = UniformInserter{ entryN, InserterMode::statistics };
+    inserter.SetSamplingMode(static_cast<SamplingMode>(state.range(0)));
+    inserter.GetEngine()->SetStream(StreamKey(StreamTag::pa, 0));
+    auto batch = SampleBatch{};
+    batch.size = SAMPLE_BATCH_SIZE;
+    for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+    {
+        batch.before[lane] = 30;
+        batch.central[lane] = static_cast<unsigned int>(lane % 4);
+    }
+    for (auto _ : state)
+    {
+        inserter.Insert_batch(batch);
+        batch.first_sample += SAMPLE_BATCH_SIZE;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * SAMPLE_BATCH_SIZE));
+    constexpr auto labels = std::array{ "plain", "antithetic", "stratified", "sobol" };
+    state.SetLabel(labels[state.range(0)]);
+}
+BENCHMARK(BM_UniformInserter_batch)->DenseRange(0, 3);
+
+static void BM_GetCenterBoundary(benchmark::State& state)
+{
+    auto entries = std::array<unsigned int, 3>{ 30, 10, 60 };
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(entries);
+        benchmark::DoNotOptimize(GetCenterBoundary(entries));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetCenterBoundary);
+
+static void BM_DisGenerator_Generate(benchmark::State& state)
+{
+    auto generator = DisGenerator<BINSIZE>{};
+    auto distribution = std::array<double, BINSIZE>{};
+    for (auto _ : state)
+    {
+        generator.Generate(distribution, 0.);
+        benchmark::DoNotOptimize(distribution);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DisGenerator_Generate);
+
+static auto Make_writer()
+{
+    return std::make_unique<CSVWriter<void (*)(void*, const Parallel_run_output&),
+                                      CSVColumn<double>,
+                                      CSVColumn<float>,
+                                      CSVColumn<float>>>([](void*, const Parallel_run_output&) {},
+                                                         CSVColumn<double>{ "pa" },
+                                                         CSVColumn<float>{ "mean" },
+                                                         CSVColumn<float>{ "stderr" });
+}
+
+static void BM_CSVWriter_add_row(benchmark::State& state)
+{
+    const auto rows = state.range(0);
+    for (auto _ : state)
+    {
+        auto writer = Make_writer();
+        for (int64_t row{}; row < rows; ++row)
+        {
+            writer->add_row(0.01 * static_cast<double>(row), 1.5F, 0.5F);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_CSVWriter_add_row)->Arg(1000)->Arg(100000);
+
+static void BM_CSVWriter_write(benchmark::State& state)
+{
+    const auto rows = state.range(0);
+    const auto filename = (std::filesystem::temp_directory_path() / "finetime_bench.csv").string();
+    auto writer = Make_writer();
+    for (int64_t row{}; row < rows; ++row)
+    {
+        writer->add_row(0.01 * static_cast<double>(row), 1.5F, 0.5F);
+    }
+    writer->SetFileName(filename);
+    auto mute = MuteCout{};
+    for (auto _ : state)
+    {
+        writer->write();
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+    std::filesystem::remove(filename);
+}
+BENCHMARK(BM_CSVWriter_write)->Arg(1000)->Arg(100000);
+
+// ----------------------------------------------------------------
+// complete sweeps over 1 .. hardware threads
+//
+// Besides the sample rate every run reports its parallel efficiency, rate / (threads * rate with one thread).
+// Both counters end up in the json report (--benchmark_out=<file> --benchmark_out_format=json).
+
+static void Thread_args(benchmark::internal::Benchmark* bench)
+{
+    const auto max_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    for (auto threads = 1U; threads < max_threads; threads *= 2)
+    {
+        bench->Arg(threads);
+    }
+    bench->Arg(max_threads);
+}
+
+static void Run_sweep_benchmark(benchmark::State& state, std::string_view name, uint64_t points, auto&& Run)
+{
+    constexpr unsigned int entryN = 100;
+    constexpr unsigned int rndNum = 20000;
+    const auto threads = static_cast<unsigned int>(state.range(0));
+    auto elapsed = std::chrono::duration<double>{};
+    for (auto _ : state)
+    {
+        auto writer = Make_writer();
+        auto fineTimeMC = FineTimeMC<>{};
+        fineTimeMC.SetThreadsNum(threads);
+        fineTimeMC.SetEntryN(entryN);
+        fineTimeMC.SetRndNumber(rndNum);
+        const auto start = std::chrono::steady_clock::now();
+        Run(fineTimeMC, *writer);
+        fineTimeMC.Wait();
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    const auto samples = static_cast<double>(state.iterations() * points * rndNum);
+    const auto rate = samples / elapsed.count();
+    static auto single_thread_rates = std::map<std::string, double, std::less<>>{};
+    if (threads == 1)
+    {
+        single_thread_rates.insert_or_assign(std::string{ name }, rate);
+    }
+    state.counters["samples_per_second"] = rate;
+    state.counters["threads"] = threads;
+    if (auto single = single_thread_rates.find(name); single != single_thread_rates.end())
+    {
+        state.counters["efficiency"] = rate / (threads * single->second);
+    }
+}
+
+static void BM_RunFixedPbAllPa(benchmark::State& state)
+{
+    constexpr unsigned int points = 64;
+    Run_sweep_benchmark(state,
+                        "pa",
+                        points,
+                        [](FineTimeMC<>& fineTimeMC, auto& writer)
+                        { fineTimeMC.RunFixedPbAllPa(DISTRIBUTION[1], 0., 1., points, writer); });
+}
+BENCHMARK(BM_RunFixedPbAllPa)->Apply(Thread_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_RunFixedPbAllEntryN(benchmark::State& state)
+{
+    constexpr int min = 10;
+    constexpr int max = 74;
+    Run_sweep_benchmark(state,
+                        "entryN",
+                        max - min,
+                        [](FineTimeMC<>& fineTimeMC, auto& writer)
+                        { fineTimeMC.RunFixedPbAllEntryN(DISTRIBUTION[1], min, max, writer); });
+}
+BENCHMARK(BM_RunFixedPbAllEntryN)->Apply(Thread_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,27 @@
+import struct
+import numpy as np
+
+MAGIC = b"FTMCCOL1"
+
+
+def read_columnar(filename):
+    '''map every column of a columnar result file as a read-only numpy array without copying'''
+    with open(filename, "rb") as file:
+        if file.read(len(MAGIC)) != MAGIC:
+            raise ValueError(f"{filename} is not a columnar file")
+        version, _page_size, rows_num, columns_num = struct.unpack("<IIQI", file.read(20))
+        if version != 1:
+            raise ValueError(f"unsupported columnar file version {version}")
+        entries = []
+        for _ in range(columns_num):
+            (name_size,) = struct.unpack("<I", file.read(4))
+            name = file.read(name_size).decode()
+            dtype = file.read(4).rstrip(b"\0").decode()
+            offset, _size = struct.unpack("<QQ", file.read(16))
+            entries.append((name, dtype, offset))
+
+    if rows_num == 0:
+        # numpy cannot map an empty block at the end of the file
+        return {name: np.empty(0, dtype=dtype) for name, dtype, _offset in entries}
+    return {name: np.memmap(filename, dtype=dtype, mode="r", offset=offset, shape=(rows_num,))
+            for name, dtype, offset in entries}
@@ -0,0 +1,192 @@
+#include "FineTimeMC.hpp"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+// Python module running the sweeps in process. Every sweep returns a dict of numpy arrays, one per column, which view
+// the vectors the results were collected in, without copying them:
+//
+//     import pyfinetime
+//     mc = pyfinetime.FineTimeMC()
+//     mc.SetThreadsNum(8)
+//     mc.SetEntryN(1000)
+//     columns = mc.RunFixedPbAllPa(0.01, 0., 1., 200)
+//     columns["pa"], columns["stderr"]
+
+namespace py = pybind11;
+
+const unsigned int SEED_NUM = 0;
+
+// columns of one sweep in sweep order, owned by the numpy arrays viewing them
+struct Sweep_columns
+{
+    std::vector<float> pa;
+    std::vector<float> pb;
+    std::vector<float> pc;
+    std::vector<unsigned int> entryN;
+    std::vector<float> mean;
+    std::vector<float> err;
+    std::vector<float> mean_err;
+    std::vector<unsigned int> samples;
+    HistogramHandle histogram; // of the first point with one, the fixed point
+};
+
+class ColumnSink : public Sinker
+{
+  public:
+    void write() override
+    {
+    }
+
+    void operator()(Parallel_run_output& result)
+    {
+        columns_->pa.push_back(result.pre_prob);
+        columns_->pb.push_back(result.mid_prob);
+        columns_->pc.push_back(result.post_prob);
+        columns_->entryN.push_back(result.entryN);
+        columns_->mean.push_back(result.stat.mean);
+        columns_->err.push_back(result.stat.err);
+        columns_->mean_err.push_back(result.stat.mean_err);
+        columns_->samples.push_back(result.sampleN);
+        if (columns_->histogram == nullptr)
+        {
+            columns_->histogram = std::move(result.histogram);
+        }
+    }
+
+    auto Release() -> std::unique_ptr<Sweep_columns>
+    {
+        return std::exchange(columns_, std::make_unique<Sweep_columns>());
+    }
+
+  private:
+    std::unique_ptr<Sweep_columns> columns_ = std::make_unique<Sweep_columns>();
+};
+
+template <typename Type>
+auto View(const Type* data, std::size_t size, const py::capsule& owner) -> py::array_t<Type>
+{
+    return py::array_t<Type>(static_cast<py::ssize_t>(size), data, owner);
+}
+
+template <typename Type>
+auto View(const std::vector<Type>& column, const py::capsule& owner) -> py::array_t<Type>
+{
+    return View(column.data(), column.size(), owner);
+}
+
+// the arrays share the ownership of the columns, which are freed with the last of them
+auto To_dict(std::unique_ptr<Sweep_columns> owned_columns) -> py::dict
+{
+    const auto* columns = owned_columns.get();
+    auto owner = py::capsule(owned_columns.get(), [](void* data) { delete static_cast<Sweep_columns*>(data); });
+    static_cast<void>(owned_columns.release());
+
+    auto dict = py::dict{};
+    dict["pa"] = View(columns->pa, owner);
+    dict["pb"] = View(columns->pb, owner);
+    dict["pc"] = View(columns->pc, owner);
+    dict["entryN"] = View(columns->entryN, owner);
+    dict["mean"] = View(columns->mean, owner);
+    dict["stderr"] = View(columns->err, owner);
+    dict["mean_err"] = View(columns->mean_err, owner);
+    dict["samples"] = View(columns->samples, owner);
+    if (const auto* histogram = columns->histogram.get(); histogram != nullptr)
+    {
+        // without underflow and overflow
+        dict["histogram"] = View(histogram->GetCounts().data() + 1, histogram->GetBinsNum(), owner);
+        dict["histogram_range"] = py::make_tuple(histogram->GetLow(), histogram->GetHigh());
+        dict["histogram_weight"] = histogram->GetWeight();
+    }
+    return dict;
+}
+
+// FineTimeMC with the results of each sweep returned as columns. The GIL is released while a sweep runs.
+template <std::size_t BinSize>
+class PyFineTimeMC
+{
+  public:
+    PyFineTimeMC()
+    {
+        engine_.SetSortedOutput(true);
+    }
+
+    auto GetEngine() -> FineTimeMC<BinSize>&
+    {
+        return engine_;
+    }
+
+    auto RunFixedPbAllPa(double midProb, double min, double max, unsigned int num) -> py::dict
+    {
+        return Run([&](ColumnSink& sink) { engine_.RunFixedPbAllPa(midProb, min, max, num, sink); });
+    }
+
+    auto RunFixedPbAllEntryN(double midProb, int min, int max) -> py::dict
+    {
+        return Run([&](ColumnSink& sink) { engine_.RunFixedPbAllEntryN(midProb, min, max, sink); });
+    }
+
+    auto RunWithAllFixed(double prob_a, double prob_b) -> py::dict
+    {
+        return Run([&](ColumnSink& sink) { engine_.RunWithAllFixed({ prob_a, prob_b, 1 - prob_a - prob_b }, sink); });
+    }
+
+  private:
+    ColumnSink sink_; // serves every sweep, declared first to outlive engine_
+    FineTimeMC<BinSize> engine_;
+
+    auto Run(auto&& Schedule) -> py::dict
+    {
+        {
+            auto release = py::gil_scoped_release{};
+            Schedule(sink_);
+            engine_.Wait();
+            engine_.Unregister(sink_);
+        }
+        return To_dict(sink_.Release());
+    }
+};
+
+template <std::size_t BinSize>
+void Bind_FineTimeMC(py::module_& pymodule, const char* name)
+{
+    using Binding = PyFineTimeMC<BinSize>;
+    py::class_<Binding>(pymodule, name)
+        .def(py::init<>())
+        .def("SetThreadsNum", [](Binding& self, unsigned int num) { self.GetEngine().SetThreadsNum(num); })
+        .def("SetRndNumber", [](Binding& self, unsigned int num) { self.GetEngine().SetRndNumber(num); })
+        .def("SetEntryN", [](Binding& self, unsigned int size) { self.GetEngine().SetEntryN(size); })
+        .def("SetSortedOutput",
+             [](Binding& self, bool is_sorted) { self.GetEngine().SetSortedOutput(is_sorted); })
+        .def("SetEngineMode", [](Binding& self, EngineMode mode) { self.GetEngine().SetEngineMode(mode); })
+        .def("SetSamplingMode", [](Binding& self, SamplingMode mode) { self.GetEngine().SetSamplingMode(mode); })
+        .def("SetConditioned",
+             [](Binding& self, bool is_conditioned) { self.GetEngine().SetConditioned(is_conditioned); })
+        .def("RunFixedPbAllPa",
+             &Binding::RunFixedPbAllPa,
+             py::arg("midProb"),
+             py::arg("min") = 0.,
+             py::arg("max") = 1.,
+             py::arg("num") = 200)
+        .def("RunFixedPbAllEntryN", &Binding::RunFixedPbAllEntryN, py::arg("midProb"), py::arg("min"), py::arg("max"))
+        .def("RunWithAllFixed", &Binding::RunWithAllFixed, py::arg("pa"), py::arg("pb"));
+}
+
+PYBIND11_MODULE(pyfinetime, pymodule)
+{
+    pymodule.doc() = "fine time Monte Carlo sweeps returning numpy columns";
+
+    py::enum_<EngineMode>(pymodule, "EngineMode")
+        .value("monte_carlo", EngineMode::monte_carlo)
+        .value("exact", EngineMode::exact)
+        .value("incremental", EngineMode::incremental);
+    py::enum_<SamplingMode>(pymodule, "SamplingMode")
+        .value("plain", SamplingMode::plain)
+        .value("antithetic", SamplingMode::antithetic)
+        .value("stratified", SamplingMode::stratified)
+        .value("sobol", SamplingMode::sobol);
+
+    Bind_FineTimeMC<3>(pymodule, "FineTimeMC3");
+    Bind_FineTimeMC<5>(pymodule, "FineTimeMC5");
+    Bind_FineTimeMC<7>(pymodule, "FineTimeMC7");
+    pymodule.attr("FineTimeMC") = pymodule.attr("FineTimeMC3");
+}
@@ -0,0 +1,33 @@
+#!/bin/bash
+# Runs one sweep as N processes on this machine with main --shard i/N and merges the shard outputs into the files an
+# unsharded run with --sorted writes, e.g.
+#   ./run_shards.sh 4 -m grid -r 10000 -t 2
+# On a batch farm every slot runs main --shard i/N itself and merge_shards is called once all of them finished.
+# The shards would share one checkpoint file, so main rejects --checkpoint together with --shard.
+# MAIN and MERGE override the executables, by default those in ./build/src.
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <number of shards> <main options>"
+    exit 1
+fi
+shards=$1
+shift
+main=${MAIN:-./build/src/main}
+merge=${MERGE:-./build/src/merge_shards}
+
+pids=()
+for ((index = 0; index < shards; ++index)); do
+    "${main}" --shard "${index}/${shards}" "$@" > "shard${index}of${shards}.log" 2>&1 &
+    pids+=($!)
+done
+for pid in "${pids[@]}"; do
+    wait "${pid}"
+done
+
+for first in *.shard0of${shards}.*; do
+    [ -e "${first}" ] || continue
+    name=${first%.shard0of${shards}.*}
+    extension=${first##*.}
+    "${merge}" -o "${name}.${extension}" "${name}".shard*of${shards}."${extension}"
+done
@@ -0,0 +1,364 @@
+#pragma once
+
+#include "CounterRNG.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+// Binomial variates without heap allocation. Small means use sequential inversion, larger ones the BTRD
+// transformed rejection of W. Hoermann, "The generation of binomial random variates" (1993).
+// The constants depending on the probability and on the number of trials are computed separately, so a
+// sampler whose trials change per draw only redoes the cheap part. A sampler whose trials stay fixed can tabulate the
+// cumulative distribution of the inversion once, see PrepareTable.
+class BinomialSampler
+{
+  public:
+    void Set(unsigned int trials, double prob)
+    {
+        SetProb(prob);
+        SetTrials(trials);
+    }
+
+    void SetProb(double prob)
+    {
+        prob = std::clamp(prob, 0., 1.);
+        is_flipped_ = prob > 0.5;
+        prob_ = is_flipped_ ? 1. - prob : prob;
+        ratio_ = (prob_ < 1.) ? prob_ / (1. - prob_) : 0.;
+        log_q_ = std::log1p(-prob_);
+        table_size_ = 0;
+    }
+
+    void SetTrials(unsigned int trials)
+    {
+        trials_ = trials;
+        table_size_ = 0;
+        mode_ = static_cast<int>((trials + 1) * prob_);
+        nr_ = (trials + 1) * ratio_;
+        if (UseInversion())
+        {
+            q_n_ = std::exp(trials * log_q_);
+            return;
+        }
+        npq_ = trials * prob_ * (1. - prob_);
+        const auto sqrt_npq = std::sqrt(npq_);
+        b_ = 1.15 + 2.53 * sqrt_npq;
+        a_ = -0.0873 + 0.0248 * b_ + 0.01 * prob_;
+        c_ = trials * prob_ + 0.5;
+        alpha_ = (2.83 + 5.1 / b_) * sqrt_npq;
+        v_r_ = 0.92 - 4.2 / b_;
+        u_rv_r_ = 0.86 * v_r_;
+    }
+
+    // Tabulates the partial sums of the pmf the sequential inversion walks through, for small means and until the
+    // tail is below round-off, as long as they fit into the table. The draws then search the table instead of
+    // evaluating the pmf recursion, which only differs by the rounding of the partial sums.
+    void PrepareTable()
+    {
+        table_size_ = 0;
+        if (trials_ == 0 || prob_ == 0. || !UseInversion())
+        {
+            return;
+        }
+        auto prob_x = q_n_;
+        auto sum = 0.;
+        for (unsigned int value{}; value < trials_;)
+        {
+            if (table_size_ == cumulative_.size())
+            {
+                table_size_ = 0;
+                return;
+            }
+            sum += prob_x;
+            cumulative_[table_size_++] = sum;
+            ++value;
+            const auto next = (nr_ / value - ratio_) * prob_x;
+            if (next < std::numeric_limits<double>::epsilon() && next < prob_x)
+            {
+                break;
+            }
+            prob_x = next;
+        }
+    }
+
+    [[nodiscard]] auto GetTrials() const -> unsigned int
+    {
+        return trials_;
+    }
+
+    auto operator()(CounterEngine& engine) const -> unsigned int
+    {
+        if (trials_ == 0 || prob_ == 0.)
+        {
+            return is_flipped_ ? trials_ : 0;
+        }
+        const auto value = UseInversion() ? Invert(engine) : Btrd(engine);
+        return is_flipped_ ? trials_ - value : value;
+    }
+
+    // probability of a nonzero variate
+    [[nodiscard]] auto GetPositiveProb() const -> double
+    {
+        if (is_flipped_)
+        {
+            return 1. - std::pow(prob_, trials_);
+        }
+        return -std::expm1(trials_ * log_q_);
+    }
+
+    // Variate of the zero-truncated distribution, which is the binomial conditioned on a nonzero value. Small means
+    // invert from 1 on, the other cases reject the zeros, which are then at most half of the draws. 0 only if no
+    // positive value is possible.
+    auto DrawPositive(CounterEngine& engine) const -> unsigned int
+    {
+        if (trials_ == 0 || prob_ == 0.)
+        {
+            return is_flipped_ ? trials_ : 0;
+        }
+        if (!is_flipped_ && UseInversion())
+        {
+            if (table_size_ > 0)
+            {
+                return std::max(Search_table(q_n_ + engine.Rndm() * GetPositiveProb()), 1U);
+            }
+            return Invert_from(engine.Rndm() * GetPositiveProb(), 1, (nr_ - ratio_) * q_n_);
+        }
+        while (true)
+        {
+            const auto value = (*this)(engine);
+            if (value > 0)
+            {
+                return value;
+            }
+        }
+    }
+
+  private:
+    unsigned int trials_ = 0;
+    int mode_ = 0;
+    bool is_flipped_ = false;
+    double prob_ = 0.;
+    double ratio_ = 0.;
+    double log_q_ = 0.;
+    double q_n_ = 1.;
+    double nr_ = 0.;
+    double npq_ = 0.;
+    double a_ = 0.;
+    double b_ = 0.;
+    double c_ = 0.;
+    double alpha_ = 0.;
+    double v_r_ = 0.;
+    double u_rv_r_ = 0.;
+    static constexpr std::size_t table_capacity = 64; // enough for the tail of every mean inverted
+    std::array<double, table_capacity> cumulative_ = {};
+    std::size_t table_size_ = 0;
+
+    [[nodiscard]] auto UseInversion() const -> bool
+    {
+        // BTRD is only valid for mean >= 10
+        constexpr int btrd_min_mode = 11;
+        return mode_ < btrd_min_mode;
+    }
+
+    [[nodiscard]] auto Invert(CounterEngine& engine) const -> unsigned int
+    {
+        if (table_size_ > 0)
+        {
+            return Search_table(engine.Rndm());
+        }
+        return Invert_from(engine.Rndm(), 0, q_n_);
+    }
+
+    // the first value whose partial sum reaches the uniform, the last one takes the tail beyond the table
+    [[nodiscard]] auto Search_table(double uniform) const -> unsigned int
+    {
+        const auto* end = cumulative_.data() + table_size_;
+        return static_cast<unsigned int>(std::lower_bound(cumulative_.data(), end, uniform) - cumulative_.data());
+    }
+
+    // sequential search from value on, where prob_x is the pmf at value
+    [[nodiscard]] auto Invert_from(double uniform, unsigned int value, double prob_x) const -> unsigned int
+    {
+        while (uniform > prob_x && value < trials_)
+        {
+            uniform -= prob_x;
+            ++value;
+            const auto next = (nr_ / value - ratio_) * prob_x;
+            // the pmf is far in its tail and decreasing: the remainder is round-off
+            if (next < std::numeric_limits<double>::epsilon() && next < prob_x)
+            {
+                break;
+            }
+            prob_x = next;
+        }
+        return value;
+    }
+
+    // Stirling series correction log(k!) - [(k + 1/2) log(k + 1) - (k + 1) + log(2 pi) / 2]
+    static auto StirlingCorrection(int value) -> double
+    {
+        constexpr auto table = std::array{ 0.08106146679532726, 0.04134069595540929, 0.02767792568499834,
+                                           0.02079067210376509, 0.01664469118982119, 0.01387612882307075,
+                                           0.01189670994589177, 0.01041126526197209, 0.009255462182712733,
+                                           0.008330563433362871 };
+        if (value < static_cast<int>(table.size()))
+        {
+            return table[value];
+        }
+        const auto inv = 1. / (value + 1);
+        const auto inv2 = inv * inv;
+        return (1. / 12 - (1. / 360 - (1. / 1260) * inv2) * inv2) * inv;
+    }
+
+    [[nodiscard]] auto Btrd(CounterEngine& engine) const -> unsigned int
+    {
+        const auto trials = static_cast<int>(trials_);
+        while (true)
+        {
+            auto v_value = engine.Rndm();
+            auto u_value = 0.;
+            if (v_value <= u_rv_r_)
+            {
+                u_value = v_value / v_r_ - 0.43;
+                return static_cast<unsigned int>(
+                    std::floor((2 * a_ / (0.5 - std::abs(u_value)) + b_) * u_value + c_));
+            }
+            if (v_value >= v_r_)
+            {
+                u_value = engine.Rndm() - 0.5;
+            }
+            else
+            {
+                u_value = v_value / v_r_ - 0.93;
+                u_value = ((u_value < 0) ? -0.5 : 0.5) - u_value;
+                v_value = engine.Rndm() * v_r_;
+            }
+
+            const auto u_s = 0.5 - std::abs(u_value);
+            const auto value = static_cast<int>(std::floor((2 * a_ / u_s + b_) * u_value + c_));
+            if (value < 0 || value > trials)
+            {
+                continue;
+            }
+            v_value = v_value * alpha_ / (a_ / (u_s * u_s) + b_);
+            const auto distance = std::abs(value - mode_);
+            constexpr int recursion_max = 15;
+            if (distance <= recursion_max)
+            {
+                // evaluate f(value) / f(mode) by the pmf recursion
+                auto ratio = 1.;
+                if (mode_ < value)
+                {
+                    for (int index = mode_ + 1; index <= value; ++index)
+                    {
+                        ratio *= (nr_ / index - ratio_);
+                    }
+                }
+                else
+                {
+                    for (int index = value + 1; index <= mode_; ++index)
+                    {
+                        v_value *= (nr_ / index - ratio_);
+                    }
+                }
+                if (v_value <= ratio)
+                {
+                    return static_cast<unsigned int>(value);
+                }
+                continue;
+            }
+
+            // squeeze and final acceptance with Stirling's formula
+            v_value = std::log(v_value);
+            const auto km = static_cast<double>(distance);
+            const auto rho = (km / npq_) * (((km / 3. + 0.625) * km + 1. / 6) / npq_ + 0.5);
+            const auto squeeze = -km * km / (2 * npq_);
+            if (v_value < squeeze - rho)
+            {
+                return static_cast<unsigned int>(value);
+            }
+            if (v_value > squeeze + rho)
+            {
+                continue;
+            }
+            const auto n_m = trials - mode_ + 1;
+            const auto h_value = (mode_ + 0.5) * std::log((mode_ + 1) / (ratio_ * n_m)) +
+                                 StirlingCorrection(mode_) + StirlingCorrection(trials - mode_);
+            const auto n_k = trials - value + 1;
+            if (v_value <= h_value + (trials + 1) * std::log(static_cast<double>(n_m) / n_k) +
+                               (value + 0.5) * std::log(n_k * ratio_ / (value + 1)) - StirlingCorrection(value) -
+                               StirlingCorrection(trials - value))
+            {
+                return static_cast<unsigned int>(value);
+            }
+        }
+    }
+};
+
+// Multinomial (N; p_0, ..., p_{K-1}) drawn from the central bin outwards: b ~ B(N, p_center), followed by the
+// binomial chain over the other bins in their order, where the last one takes the remaining entries. For three bins
+// this is b ~ B(N, pb), a ~ B(N - b, pa / (1 - pb)), c = N - a - b.
+// The central stage is fully set up once per point, the chain only updates its trial dependent constants.
+template <std::size_t BinSize>
+class CentralMultinomialSampler
+{
+  public:
+    static_assert(BinSize % 2 == 1 && BinSize >= 3, "the central bin needs an odd number of bins");
+    static constexpr std::size_t center = BinSize / 2;
+
+    void Set(unsigned int entryN, const auto& distribution)
+    {
+        entryN_ = entryN;
+        central_.Set(entryN, distribution[center]);
+        central_.PrepareTable();
+        auto prob_left = 1. - distribution[center];
+        for (std::size_t link{}; link < chain_.size(); ++link)
+        {
+            const auto prob = distribution[Chain_bin(link)];
+            chain_[link].SetProb((prob_left > 0.) ? prob / prob_left : 0.);
+            prob_left -= prob;
+        }
+    }
+
+    // With is_conditioned the central bin is never empty unless it cannot be filled: its count is drawn from the
+    // zero-truncated binomial and the chain stays as it is, which gives the multinomial conditioned on a nonzero
+    // central bin. Each draw then stands for 1 / GetWeight() unconditioned ones.
+    void SetConditioned(bool is_conditioned)
+    {
+        is_conditioned_ = is_conditioned;
+    }
+
+    // importance weight of every draw, its probability under the multinomial over the one it is drawn with
+    [[nodiscard]] auto GetWeight() const -> double
+    {
+        return is_conditioned_ ? central_.GetPositiveProb() : 1.;
+    }
+
+    void operator()(CounterEngine& engine, std::array<unsigned int, BinSize>& entries)
+    {
+        entries[center] = is_conditioned_ ? central_.DrawPositive(engine) : central_(engine);
+        auto entries_left = entryN_ - entries[center];
+        for (std::size_t link{}; link < chain_.size(); ++link)
+        {
+            chain_[link].SetTrials(entries_left);
+            auto& entry = entries[Chain_bin(link)];
+            entry = chain_[link](engine);
+            entries_left -= entry;
+        }
+        entries.back() = entries_left;
+    }
+
+  private:
+    unsigned int entryN_ = 0;
+    bool is_conditioned_ = false;
+    BinomialSampler central_;
+    std::array<BinomialSampler, BinSize - 2> chain_;
+
+    static constexpr auto Chain_bin(std::size_t link) -> std::size_t
+    {
+        return (link < center) ? link : link + 1;
+    }
+};
+
+using TrinomialSampler = CentralMultinomialSampler<3>;
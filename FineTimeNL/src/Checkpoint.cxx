@@ -0,0 +1,158 @@
+#include "Checkpoint.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fmt/core.h>
+#include <iostream>
+#include <stdexcept>
+
+constexpr int CHECKPOINT_VERSION = 6;
+
+Checkpoint::Checkpoint(std::string filename, const Signature& signature, bool is_resumed)
+    : filename_{ std::move(filename) }
+{
+    if (is_resumed && std::filesystem::exists(filename_))
+    {
+        Load(signature);
+    }
+
+    // the complete file is written to a temporary first, so a crash here leaves the old checkpoint intact
+    const auto temp_filename = filename_ + ".tmp";
+    {
+        auto temp_file = std::ofstream{ temp_filename, std::ios_base::out | std::ios_base::trunc };
+        temp_file << Format_header(signature);
+        for (const auto& [key, output] : finished_)
+        {
+            temp_file << Format_point(key, output);
+        }
+        if (!temp_file.flush())
+        {
+            throw std::runtime_error(fmt::format("cannot write checkpoint file {}!", temp_filename));
+        }
+    }
+    std::filesystem::rename(temp_filename, filename_);
+    file_.open(filename_, std::ios_base::out | std::ios_base::app);
+}
+
+Checkpoint::~Checkpoint()
+{
+    Flush();
+}
+
+auto Checkpoint::Find(std::size_t writer_index, uint64_t stream) const -> const Parallel_run_output*
+{
+    auto point = finished_.find(Key{ writer_index, stream });
+    return (point == finished_.end()) ? nullptr : &point->second;
+}
+
+void Checkpoint::Add(std::size_t writer_index, uint64_t stream, const Parallel_run_output& output)
+{
+    auto lock = LockTimed(mu_pending_);
+    pending_ += Format_point(Key{ writer_index, stream }, output);
+    if (std::chrono::steady_clock::now() - last_flush_ >= flush_interval_)
+    {
+        Write_pending();
+    }
+}
+
+void Checkpoint::Flush()
+{
+    auto lock = std::lock_guard{ mu_pending_ };
+    Write_pending();
+}
+
+void Checkpoint::Write_pending()
+{
+    file_ << pending_;
+    file_.flush();
+    pending_.clear();
+    last_flush_ = std::chrono::steady_clock::now();
+}
+
+void Checkpoint::Load(const Signature& signature)
+{
+    auto file = std::ifstream{ filename_ };
+    auto line = std::string{};
+    std::getline(file, line);
+    auto version = 0;
+    auto loaded = Signature{};
+    if (std::sscanf(line.c_str(),
+                    "# FTMCCKPT %d %" SCNu64 " %u %u %d %la %u %zu %d %d",
+                    &version,
+                    &loaded.seed,
+                    &loaded.entryN,
+                    &loaded.rndNum,
+                    &loaded.engine_mode,
+                    &loaded.precision,
+                    &loaded.block_size,
+                    &loaded.bins,
+                    &loaded.sampling,
+                    &loaded.is_conditioned) != 10 ||
+        version != CHECKPOINT_VERSION)
+    {
+        throw std::logic_error(fmt::format("{} is not a checkpoint file!", filename_));
+    }
+    if (loaded != signature)
+    {
+        throw std::logic_error(fmt::format("checkpoint {} was written with different settings!", filename_));
+    }
+
+    while (std::getline(file, line))
+    {
+        auto key = Key{};
+        auto output = Parallel_run_output{};
+        auto end = 0;
+        // a line without its trailing newline was cut off and is recomputed
+        if (file.eof() || std::sscanf(line.c_str(),
+                                      "%zu %" SCNu64 " %u %u %u %a %a %a %a %a %a%n",
+                                      &key.first,
+                                      &key.second,
+                                      &output.entryN,
+                                      &output.sampleN,
+                                      &output.filledN,
+                                      &output.stat.mean,
+                                      &output.stat.err,
+                                      &output.stat.mean_err,
+                                      &output.pre_prob,
+                                      &output.mid_prob,
+                                      &output.post_prob,
+                                      &end) != 11 ||
+            static_cast<std::size_t>(end) != line.size())
+        {
+            continue;
+        }
+        finished_.insert_or_assign(key, std::move(output));
+    }
+    std::cout << "restored " << finished_.size() << " points from checkpoint " << filename_ << "\n";
+}
+
+auto Checkpoint::Format_header(const Signature& signature) -> std::string
+{
+    return fmt::format("# FTMCCKPT {} {} {} {} {} {:a} {} {} {} {}\n",
+                       CHECKPOINT_VERSION,
+                       signature.seed,
+                       signature.entryN,
+                       signature.rndNum,
+                       signature.engine_mode,
+                       signature.precision,
+                       signature.block_size,
+                       signature.bins,
+                       signature.sampling,
+                       signature.is_conditioned);
+}
+
+auto Checkpoint::Format_point(const Key& key, const Parallel_run_output& output) -> std::string
+{
+    return fmt::format("{} {} {} {} {} {:a} {:a} {:a} {:a} {:a} {:a}\n",
+                       key.first,
+                       key.second,
+                       output.entryN,
+                       output.sampleN,
+                       output.filledN,
+                       output.stat.mean,
+                       output.stat.err,
+                       output.stat.mean_err,
+                       output.pre_prob,
+                       output.mid_prob,
+                       output.post_prob);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Telemetry.hpp"
+#include "traits.hpp"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Append-only file of finished parameter points. A point is identified by its writer and its random stream, which
+// together with the seed completely determine its result, so a restored point is identical to a recomputed one.
+// Values are stored as hexadecimal floats to survive the round trip exactly. Points with histograms are not recorded.
+//
+//   # FTMCCKPT <version> <seed> <entryN> <rndNum> <engine mode> <precision> <block size> <bins> <sampling mode>
+//     <conditioned>
+//   <writer index> <stream> <entryN> <sampleN> <filledN> <mean> <err> <mean_err> <pre_prob> <mid_prob> <post_prob>
+class Checkpoint
+{
+  public:
+    // settings the recorded results depend on, a resumed run must use the same ones
+    struct Signature
+    {
+        uint64_t seed = 0;
+        unsigned int entryN = 0;
+        unsigned int rndNum = 0;
+        int engine_mode = 0;
+        double precision = 0.;
+        unsigned int block_size = 0;
+        std::size_t bins = 3;
+        int sampling = 0;
+        int is_conditioned = 0;
+        auto operator==(const Signature&) const -> bool = default;
+    };
+
+    // Without resuming an existing file is overwritten. When resuming, the finished points are loaded and the file
+    // is rewritten with them, which drops a line cut off by a crash.
+    Checkpoint(std::string filename, const Signature& signature, bool is_resumed);
+    ~Checkpoint();
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint(Checkpoint&&) = delete;
+    auto operator=(const Checkpoint&) -> Checkpoint& = delete;
+    auto operator=(Checkpoint&&) -> Checkpoint& = delete;
+
+    void SetFlushInterval(std::chrono::seconds interval)
+    {
+        flush_interval_ = interval;
+    }
+
+    // only reads the points loaded at construction, safe to call from any thread
+    [[nodiscard]] auto Find(std::size_t writer_index, uint64_t stream) const -> const Parallel_run_output*;
+
+    // thread safe, the file is written at most once per flush interval
+    void Add(std::size_t writer_index, uint64_t stream, const Parallel_run_output& output);
+    void Flush();
+
+  private:
+    using Key = std::pair<std::size_t, uint64_t>;
+    std::string filename_;
+    std::map<Key, Parallel_run_output> finished_;
+    std::mutex mu_pending_;
+    std::string pending_;
+    std::ofstream file_;
+    std::chrono::seconds flush_interval_{ 60 };
+    std::chrono::steady_clock::time_point last_flush_ = std::chrono::steady_clock::now();
+
+    void Load(const Signature& signature);
+    void Write_pending();
+    static auto Format_header(const Signature& signature) -> std::string;
+    static auto Format_point(const Key& key, const Parallel_run_output& output) -> std::string;
+};
@@ -0,0 +1,357 @@
+#pragma once
+
+#include "Sinker.hpp"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Columnar binary result file, all numbers little endian:
+//
+//   char[8]  magic "FTMCCOL1"
+//   uint32   version
+//   uint32   page size, alignment of every column block
+//   uint64   number of rows
+//   uint32   number of columns
+//   per column:
+//     uint32   name length, followed by the name without terminator
+//     char[4]  numpy dtype string, e.g. "<f8", zero padded
+//     uint64   file offset of the column block
+//     uint64   size of the column block in bytes
+//
+// Each column block starts at a multiple of the page size, so it can be memory mapped on its own, e.g. with
+// numpy.memmap(path, dtype, mode="r", offset=offset, shape=(rows,)).
+
+static_assert(std::endian::native == std::endian::little, "columnar files are written in native little endian");
+
+constexpr auto COLUMNAR_MAGIC = std::string_view{ "FTMCCOL1" };
+constexpr uint32_t COLUMNAR_VERSION = 1;
+constexpr uint32_t COLUMNAR_PAGE_SIZE = 4096;
+
+template <typename DataType>
+constexpr auto GetColumnDType() -> std::string_view
+{
+    static_assert(std::is_arithmetic_v<DataType> && !std::is_same_v<DataType, bool>,
+                  "only numeric columns can be stored in columnar files");
+    if constexpr (std::is_floating_point_v<DataType>)
+    {
+        return (sizeof(DataType) == 4) ? "<f4" : "<f8";
+    }
+    else if constexpr (std::is_signed_v<DataType>)
+    {
+        constexpr auto types = std::array<std::string_view, 9>{ "", "<i1", "<i2", "", "<i4", "", "", "", "<i8" };
+        return types[sizeof(DataType)];
+    }
+    else
+    {
+        constexpr auto types = std::array<std::string_view, 9>{ "", "<u1", "<u2", "", "<u4", "", "", "", "<u8" };
+        return types[sizeof(DataType)];
+    }
+}
+
+// item size in bytes of a dtype written by GetColumnDType, 0 for any other dtype
+constexpr auto GetColumnItemSize(std::string_view dtype) -> std::size_t
+{
+    if (dtype.size() != 3 || dtype[0] != '<' || std::string_view{ "fiu" }.find(dtype[1]) == std::string_view::npos)
+    {
+        return 0;
+    }
+    switch (dtype[2])
+    {
+        case '1':
+            return (dtype[1] == 'f') ? 0 : 1;
+        case '2':
+            return (dtype[1] == 'f') ? 0 : 2;
+        case '4':
+            return 4;
+        case '8':
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+// one column of a columnar file, data holds rows * sizeof(dtype) bytes
+struct Column_block
+{
+    std::string_view name;
+    std::string_view dtype;
+    std::string_view data;
+};
+
+// writes the layout described above, shared by ColumnarWriter and the shard merging
+inline void Write_columnar(std::ostream& ostream, uint64_t rows_num, std::span<const Column_block> blocks)
+{
+    auto Align = [](uint64_t offset) -> uint64_t
+    { return (offset + COLUMNAR_PAGE_SIZE - 1) / COLUMNAR_PAGE_SIZE * COLUMNAR_PAGE_SIZE; };
+    auto Put = [](std::string& buffer, auto value)
+    { buffer.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+    auto header_size = COLUMNAR_MAGIC.size() + 3 * sizeof(uint32_t) + sizeof(uint64_t);
+    for (const auto& block : blocks)
+    {
+        header_size += sizeof(uint32_t) + block.name.size() + 4 + 2 * sizeof(uint64_t);
+    }
+
+    auto header = std::string{ COLUMNAR_MAGIC };
+    Put(header, COLUMNAR_VERSION);
+    Put(header, COLUMNAR_PAGE_SIZE);
+    Put(header, rows_num);
+    Put(header, static_cast<uint32_t>(blocks.size()));
+
+    auto offset = Align(header_size);
+    for (const auto& block : blocks)
+    {
+        Put(header, static_cast<uint32_t>(block.name.size()));
+        header.append(block.name);
+        header.append(block.dtype);
+        header.append(4 - block.dtype.size(), '\0');
+        Put(header, offset);
+        Put(header, static_cast<uint64_t>(block.data.size()));
+        offset = Align(offset + block.data.size());
+    }
+    ostream.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    auto position = static_cast<uint64_t>(header.size());
+    for (const auto& block : blocks)
+    {
+        const auto padding = std::string(Align(position) - position, '\0');
+        ostream.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        ostream.write(block.data.data(), static_cast<std::streamsize>(block.data.size()));
+        position = Align(position) + block.data.size();
+    }
+}
+
+template <typename WriteStrategy, typename... ColumnTypes>
+class ColumnarWriter : public Sinker
+{
+  public:
+    explicit ColumnarWriter(WriteStrategy&& strategy, ColumnTypes&&... columns)
+        : columns_{ std::make_tuple(std::forward<ColumnTypes>(columns)...) }
+        , write_strategy_{ std::forward<WriteStrategy>(strategy) }
+    {
+    }
+
+    void add_row(auto&&... args)
+        requires Equal<sizeof...(args), sizeof...(ColumnTypes)>
+    {
+        Push_row(columns_, std::forward<decltype(args)>(args)...);
+    }
+
+    void write() override
+    {
+        if (filename_.empty())
+        {
+            throw std::logic_error("columnar output filename not specified!");
+        }
+        auto timer = PhaseTimer{ Phase::write };
+        std::cout << "writing to file " << filename_ << "\n";
+        auto ostream =
+            std::ofstream(filename_.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+        write_to_file(ostream);
+        std::cout << "writing to file " << filename_ << " finished\n";
+    }
+
+    void SetFileName(std::string_view filename)
+    {
+        filename_ = filename;
+    }
+
+    void operator()(const auto& result)
+    {
+        write_strategy_(this, result);
+    }
+
+  private:
+    std::tuple<ColumnTypes...> columns_;
+    std::string filename_;
+    WriteStrategy write_strategy_;
+
+    void write_to_file(std::ofstream& ostream)
+    {
+        const auto rows_num = static_cast<uint64_t>(std::get<0>(columns_).size());
+        auto blocks = std::vector<Column_block>{};
+        auto Add_block = [&blocks](const auto& column)
+        {
+            using DataType = typename std::remove_cvref_t<decltype(column)>::Type;
+            const auto& data = column.get();
+            blocks.push_back(Column_block{ .name = column.get_name(),
+                                           .dtype = GetColumnDType<DataType>(),
+                                           .data = { reinterpret_cast<const char*>(data.data()),
+                                                     data.size() * sizeof(data[0]) } });
+        };
+        Apply_element_wise(Add_block, columns_);
+        Write_columnar(ostream, rows_num, blocks);
+    }
+};
+
+// Read only memory map of a columnar file with typed, zero-copy access to its columns.
+class ColumnarFile
+{
+  public:
+    struct Column
+    {
+        std::string name;
+        std::string dtype;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    explicit ColumnarFile(const std::string& filename)
+    {
+        auto file = open(filename.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            throw std::runtime_error(fmt::format("cannot open columnar file {}!", filename));
+        }
+        struct stat file_stat = {};
+        if (fstat(file, &file_stat) != 0)
+        {
+            close(file);
+            throw std::runtime_error(fmt::format("cannot stat columnar file {}!", filename));
+        }
+        size_ = static_cast<std::size_t>(file_stat.st_size);
+        data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+        close(file);
+        if (data_ == MAP_FAILED)
+        {
+            throw std::runtime_error(fmt::format("cannot map columnar file {}!", filename));
+        }
+        try
+        {
+            Read_header();
+        }
+        catch (...)
+        {
+            munmap(data_, size_);
+            throw;
+        }
+    }
+
+    ~ColumnarFile()
+    {
+        munmap(data_, size_);
+    }
+
+    ColumnarFile(const ColumnarFile&) = delete;
+    ColumnarFile(ColumnarFile&&) = delete;
+    auto operator=(const ColumnarFile&) -> ColumnarFile& = delete;
+    auto operator=(ColumnarFile&&) -> ColumnarFile& = delete;
+
+    [[nodiscard]] auto GetRowsNum() const -> uint64_t
+    {
+        return rows_num_;
+    }
+
+    [[nodiscard]] auto GetColumns() const -> const auto&
+    {
+        return columns_;
+    }
+
+    // untyped content of a column, rows times the item size bytes
+    [[nodiscard]] auto GetColumnBytes(const Column& column) const -> std::string_view
+    {
+        return { static_cast<const char*>(data_) + column.offset, column.size };
+    }
+
+    template <typename DataType>
+    [[nodiscard]] auto GetColumn(std::string_view name) const -> std::span<const DataType>
+    {
+        for (const auto& column : columns_)
+        {
+            if (column.name != name)
+            {
+                continue;
+            }
+            if (column.dtype != GetColumnDType<DataType>())
+            {
+                throw std::logic_error(fmt::format("column {} has dtype {}!", name, column.dtype));
+            }
+            const auto* begin = static_cast<const char*>(data_) + column.offset;
+            return { reinterpret_cast<const DataType*>(begin), rows_num_ };
+        }
+        throw std::logic_error(fmt::format("column {} not found!", name));
+    }
+
+  private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+    uint64_t rows_num_ = 0;
+    std::vector<Column> columns_;
+
+    void Read_header()
+    {
+        const auto* bytes = static_cast<const char*>(data_);
+        auto position = std::size_t{};
+        auto Get = [bytes, &position, this](auto& value)
+        {
+            if (position + sizeof(value) > size_)
+            {
+                throw std::runtime_error("truncated columnar file!");
+            }
+            std::memcpy(&value, bytes + position, sizeof(value));
+            position += sizeof(value);
+        };
+
+        if (size_ < COLUMNAR_MAGIC.size() || std::string_view{ bytes, COLUMNAR_MAGIC.size() } != COLUMNAR_MAGIC)
+        {
+            throw std::runtime_error("not a columnar file!");
+        }
+        position += COLUMNAR_MAGIC.size();
+        auto version = uint32_t{};
+        auto page_size = uint32_t{};
+        auto columns_num = uint32_t{};
+        Get(version);
+        Get(page_size);
+        Get(rows_num_);
+        Get(columns_num);
+        if (version != COLUMNAR_VERSION)
+        {
+            throw std::runtime_error(fmt::format("unsupported columnar file version {}!", version));
+        }
+
+        for (uint32_t index{}; index < columns_num; ++index)
+        {
+            auto column = Column{};
+            auto name_size = uint32_t{};
+            Get(name_size);
+            if (position + name_size > size_)
+            {
+                throw std::runtime_error("truncated columnar file!");
+            }
+            column.name.assign(bytes + position, name_size);
+            position += name_size;
+            auto dtype = std::array<char, 4>{};
+            Get(dtype);
+            column.dtype = std::string{ dtype.data(), strnlen(dtype.data(), dtype.size()) };
+            Get(column.offset);
+            Get(column.size);
+            if (column.offset > size_ || column.size > size_ - column.offset)
+            {
+                throw std::runtime_error(fmt::format("column {} exceeds the file!", column.name));
+            }
+            // the first comparison keeps the product from overflowing
+            const auto item_size = GetColumnItemSize(column.dtype);
+            if (item_size == 0)
+            {
+                throw std::runtime_error(fmt::format("column {} has unknown dtype {}!", column.name, column.dtype));
+            }
+            if (rows_num_ > column.size / item_size || rows_num_ * item_size != column.size)
+            {
+                throw std::runtime_error(fmt::format("column {} has {} bytes instead of {} rows of {}!",
+                                                     column.name,
+                                                     column.size,
+                                                     rows_num_,
+                                                     column.dtype));
+            }
+            columns_.emplace_back(std::move(column));
+        }
+    }
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Philox4x32-10 block cipher from Salmon et al., "Parallel random numbers: as easy as 1, 2, 3" (SC11).
+// Every output block is a pure function of (key, counter), so any stream position can be reached in O(1).
+class Philox4x32
+{
+  public:
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static constexpr auto Block(Counter counter, Key key) -> Counter
+    {
+        constexpr int rounds = 10;
+        for (int round{}; round < rounds; ++round)
+        {
+            counter = Round(counter, key);
+            key[0] += weyl_0;
+            key[1] += weyl_1;
+        }
+        return counter;
+    }
+
+  private:
+    static constexpr uint32_t multiplier_0 = 0xD2511F53;
+    static constexpr uint32_t multiplier_1 = 0xCD9E8D57;
+    static constexpr uint32_t weyl_0 = 0x9E3779B9;
+    static constexpr uint32_t weyl_1 = 0xBB67AE85;
+
+    static constexpr auto Round(const Counter& counter, const Key& key) -> Counter
+    {
+        constexpr int shift = 32;
+        const auto product_0 = uint64_t{ multiplier_0 } * counter[0];
+        const auto product_1 = uint64_t{ multiplier_1 } * counter[2];
+        return { static_cast<uint32_t>(product_1 >> shift) ^ counter[1] ^ key[0],
+                 static_cast<uint32_t>(product_1),
+                 static_cast<uint32_t>(product_0 >> shift) ^ counter[3] ^ key[1],
+                 static_cast<uint32_t>(product_0) };
+    }
+};
+
+// Sweeps use disjoint stream ranges so that the same point index in different modes never shares random numbers.
+enum class StreamTag : uint64_t
+{
+    distribution = 1,
+    pa = 2,
+    entryN = 3,
+    fix = 4,
+    grid = 5,
+    entryN_step = 6, // trials adding one entry per step of the incremental entryN engine
+};
+
+constexpr auto StreamKey(StreamTag tag, uint64_t index) -> uint64_t
+{
+    constexpr unsigned int tag_shift = 56;
+    return (static_cast<uint64_t>(tag) << tag_shift) | index;
+}
+
+// Random engine addressed by (seed, stream, sample). A stream identifies a parameter point, a sample is one
+// multinomial draw together with its in-bin position. The engine holds no shared state, so results only depend on
+// these three numbers and not on which thread evaluates them.
+class CounterEngine
+{
+  public:
+    // adaptor for the <random> distributions
+    class BitGenerator
+    {
+      public:
+        using result_type = uint32_t;
+        explicit BitGenerator(CounterEngine* engine)
+            : engine_{ engine }
+        {
+        }
+        static constexpr auto min() -> result_type
+        {
+            return 0;
+        }
+        static constexpr auto max() -> result_type
+        {
+            return std::numeric_limits<result_type>::max();
+        }
+        auto operator()() -> result_type
+        {
+            return engine_->NextUInt();
+        }
+
+      private:
+        CounterEngine* engine_ = nullptr;
+    };
+
+    CounterEngine() = default;
+    explicit CounterEngine(uint64_t seed, uint64_t stream = 0)
+    {
+        SetSeed(seed);
+        SetStream(stream);
+    }
+
+    void SetSeed(uint64_t seed)
+    {
+        key_ = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> word_shift) };
+        Restart();
+    }
+
+    void SetStream(uint64_t stream)
+    {
+        counter_[2] = static_cast<uint32_t>(stream);
+        counter_[3] = static_cast<uint32_t>(stream >> word_shift);
+        counter_[1] = 0;
+        Restart();
+    }
+
+    void SetSample(uint64_t sample)
+    {
+        counter_[1] = static_cast<uint32_t>(sample);
+        Restart();
+    }
+
+    // same as SetSample, with the first block of the draw already computed, e.g. by FillDrawBlocks
+    void SetSample(uint64_t sample, const Philox4x32::Counter& first_block)
+    {
+        counter_[1] = static_cast<uint32_t>(sample);
+        counter_[0] = 1;
+        buffer_ = first_block;
+        buffer_index_ = 0;
+    }
+
+    [[nodiscard]] auto GetSample() const -> uint64_t
+    {
+        return counter_[1];
+    }
+
+    [[nodiscard]] auto GetStream() const -> uint64_t
+    {
+        return (uint64_t{ counter_[3] } << word_shift) | counter_[2];
+    }
+
+    [[nodiscard]] auto GetKey() const -> const Philox4x32::Key&
+    {
+        return key_;
+    }
+
+    // Uniform in (0, 1) for the in-bin position of the current sample. It comes from a reserved block and thus
+    // does not depend on how many numbers the multinomial draw consumed, which lets batched kernels compute it.
+    [[nodiscard]] auto SampleUniform() const -> double
+    {
+        const auto block = Philox4x32::Block({ PLACEMENT_BLOCK, counter_[1], counter_[2], counter_[3] }, key_);
+        return ToUniform(block[0], block[1]);
+    }
+
+    static constexpr auto ToUniform(uint32_t high, uint32_t low) -> double
+    {
+        constexpr unsigned int high_shift = 5;
+        constexpr unsigned int low_shift = 6;
+        constexpr double high_scale = 67108864.;                // 2^26
+        constexpr double inv_mantissa = 1. / 9007199254740992.; // 2^-53
+        return ((high >> high_shift) * high_scale + (low >> low_shift) + 0.5) * inv_mantissa;
+    }
+
+    static constexpr uint32_t PLACEMENT_BLOCK = 0xFFFFFFFF;
+
+    auto NextUInt() -> uint32_t
+    {
+        if (buffer_index_ == buffer_.size())
+        {
+            buffer_ = Philox4x32::Block(counter_, key_);
+            ++counter_[0];
+            buffer_index_ = 0;
+        }
+        return buffer_[buffer_index_++];
+    }
+
+    // uniform double in the open interval (0, 1) with 53 random bits
+    auto Rndm() -> double
+    {
+        const auto high = NextUInt();
+        return ToUniform(high, NextUInt());
+    }
+
+    auto operator()() -> double
+    {
+        return Rndm();
+    }
+
+    auto Binomial(unsigned int ntot, double prob) -> unsigned int
+    {
+        if (ntot == 0 || prob <= 0.)
+        {
+            return 0;
+        }
+        if (prob >= 1.)
+        {
+            return ntot;
+        }
+        auto bits = BitGenerator{ this };
+        return std::binomial_distribution<unsigned int>{ ntot, prob }(bits);
+    }
+
+    // same interface as ROOT::Math::GSLRandomEngine::Multinomial (conditional binomial chain)
+    auto Multinomial(unsigned int ntot, const std::vector<double>& prob) -> std::vector<unsigned int>
+    {
+        auto entries = std::vector<unsigned int>(prob.size(), 0);
+        auto prob_left = 1.;
+        for (size_t index{}; index + 1 < prob.size() && ntot > 0; ++index)
+        {
+            entries[index] = Binomial(ntot, (prob_left > 0.) ? prob[index] / prob_left : 0.);
+            ntot -= entries[index];
+            prob_left -= prob[index];
+        }
+        if (!entries.empty())
+        {
+            entries.back() += ntot;
+        }
+        return entries;
+    }
+
+  private:
+    static constexpr unsigned int word_shift = 32;
+    Philox4x32::Key key_ = {};
+    // { draw index, sample, stream low, stream high }
+    Philox4x32::Counter counter_ = {};
+    Philox4x32::Counter buffer_ = {};
+    size_t buffer_index_ = 0;
+
+    void Restart()
+    {
+        counter_[0] = 0;
+        buffer_index_ = buffer_.size();
+    }
+};
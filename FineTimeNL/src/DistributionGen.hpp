@@ -1,5 +1,5 @@
 #pragma once
-#include <Math/GSLRndmEngines.h>
+#include "CounterRNG.hpp"
 #include <iostream>
 #include <range/v3/all.hpp>
 #include <span>
@@ -15,9 +15,8 @@ class DisGenerator
 {
   public:
     explicit DisGenerator()
+        : engine_{ SEED_NUM, StreamKey(StreamTag::distribution, 0) }
     {
-        engine_.Initialize();
-        engine_.SetSeed(SEED_NUM);
     }
 
     auto UniformSplit(double totalProb, std::span<double> distribution) const
@@ -55,5 +54,5 @@ class DisGenerator
     }
 
   private:
-    ROOT::Math::GSLRandomEngine engine_ = {};
+    mutable CounterEngine engine_;
 };
@@ -0,0 +1,260 @@
+#include "ErrorModels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+
+namespace
+{
+    auto Pre_term(const Model_point& point) -> double
+    {
+        const auto [pa, pb, entryN] = point;
+        return entryN * (pa - pa * pa - pb * pa + pb / 3 - pb * pb / 3);
+    }
+
+    auto Base_term(const Model_point& point) -> double
+    {
+        return point.entryN * point.entryN / 12 * point.pb * point.pb;
+    }
+
+    using Matrix = std::vector<std::vector<double>>;
+
+    // Gaussian elimination with partial pivoting, nothing for a singular matrix
+    auto Solve_linear(Matrix matrix, std::vector<double> rhs) -> std::optional<std::vector<double>>
+    {
+        const auto size = rhs.size();
+        for (std::size_t column{}; column < size; ++column)
+        {
+            auto pivot = column;
+            for (auto row = column + 1; row < size; ++row)
+            {
+                if (std::abs(matrix[row][column]) > std::abs(matrix[pivot][column]))
+                {
+                    pivot = row;
+                }
+            }
+            if (matrix[pivot][column] == 0.)
+            {
+                return std::nullopt;
+            }
+            std::swap(matrix[pivot], matrix[column]);
+            std::swap(rhs[pivot], rhs[column]);
+            for (auto row = column + 1; row < size; ++row)
+            {
+                const auto factor = matrix[row][column] / matrix[column][column];
+                for (auto index = column; index < size; ++index)
+                {
+                    matrix[row][index] -= factor * matrix[column][index];
+                }
+                rhs[row] -= factor * rhs[column];
+            }
+        }
+        auto solution = std::vector<double>(size);
+        for (auto row = size; row-- > 0;)
+        {
+            auto sum = rhs[row];
+            for (auto index = row + 1; index < size; ++index)
+            {
+                sum -= matrix[row][index] * solution[index];
+            }
+            solution[row] = sum / matrix[row][row];
+        }
+        return solution;
+    }
+
+    class Least_squares
+    {
+      public:
+        Least_squares(const Error_model& model, const Model_data& data)
+            : model_{ model }
+        {
+            for (std::size_t index{}; index < data.points.size(); ++index)
+            {
+                if (data.sigmas[index] > 0.)
+                {
+                    points_.push_back(data.points[index]);
+                    values_.push_back(data.values[index]);
+                    sigmas_.push_back(data.sigmas[index]);
+                }
+            }
+            model_values_.resize(points_.size());
+            shifted_values_.resize(points_.size());
+        }
+
+        [[nodiscard]] auto GetPointsNum() const -> std::size_t
+        {
+            return points_.size();
+        }
+
+        auto Chi2(std::span<const double> parameters) -> double
+        {
+            model_.evaluate(points_, parameters, model_values_);
+            auto chi2 = 0.;
+            for (std::size_t index{}; index < points_.size(); ++index)
+            {
+                const auto pull = (values_[index] - model_values_[index]) / sigmas_[index];
+                chi2 += pull * pull;
+            }
+            return chi2;
+        }
+
+        // J^T J and J^T r of the weighted residuals r at parameters, the model values are those of the last Chi2
+        void Linearize(std::vector<double> parameters, Matrix& curvature, std::vector<double>& gradient)
+        {
+            const auto pars_num = parameters.size();
+            auto jacobian = Matrix(pars_num, std::vector<double>(points_.size()));
+            for (std::size_t par{}; par < pars_num; ++par)
+            {
+                const auto value = parameters[par];
+                const auto step = 1e-6 * std::max(std::abs(value), 1.);
+                parameters[par] = value + step;
+                model_.evaluate(points_, parameters, shifted_values_);
+                jacobian[par] = shifted_values_;
+                parameters[par] = value - step;
+                model_.evaluate(points_, parameters, shifted_values_);
+                parameters[par] = value;
+                for (std::size_t index{}; index < points_.size(); ++index)
+                {
+                    jacobian[par][index] =
+                        (jacobian[par][index] - shifted_values_[index]) / (2 * step * sigmas_[index]);
+                }
+            }
+            curvature.assign(pars_num, std::vector<double>(pars_num));
+            gradient.assign(pars_num, 0.);
+            for (std::size_t row{}; row < pars_num; ++row)
+            {
+                for (std::size_t index{}; index < points_.size(); ++index)
+                {
+                    gradient[row] += jacobian[row][index] * (values_[index] - model_values_[index]) / sigmas_[index];
+                }
+                for (std::size_t column{}; column < pars_num; ++column)
+                {
+                    for (std::size_t index{}; index < points_.size(); ++index)
+                    {
+                        curvature[row][column] += jacobian[row][index] * jacobian[column][index];
+                    }
+                }
+            }
+        }
+
+      private:
+        const Error_model& model_;
+        std::vector<Model_point> points_;
+        std::vector<double> values_;
+        std::vector<double> sigmas_;
+        std::vector<double> model_values_;
+        std::vector<double> shifted_values_;
+    };
+} // namespace
+
+auto Err_pre_model() -> Error_model
+{
+    return Pointwise_model("err_pre",
+                           [](const Model_point& point, std::span<const double> /*parameters*/)
+                           { return std::sqrt(Base_term(point) + Pre_term(point)); });
+}
+
+auto Err_pre_approx_model() -> Error_model
+{
+    return Pointwise_model(
+        "err_pre_approx",
+        [](const Model_point& point, std::span<const double> /*parameters*/)
+        {
+            const auto [pa, pb, entryN] = point;
+            return entryN / std::sqrt(12.) * pb + std::sqrt(3.) / pb * (0.25 - (pa - 0.5) * (pa - 0.5));
+        });
+}
+
+auto Err_pre_base_model() -> Error_model
+{
+    return Pointwise_model("err_pre_base",
+                           [](const Model_point& point, std::span<const double> /*parameters*/)
+                           { return std::sqrt(Base_term(point)); });
+}
+
+auto Err_pre_scaled_model() -> Error_model
+{
+    return Pointwise_model(
+        "err_pre_scaled",
+        [](const Model_point& point, std::span<const double> parameters)
+        { return std::sqrt(std::max(parameters[0] * Base_term(point) + parameters[1] * Pre_term(point), 0.)); },
+        { 1., 1. });
+}
+
+auto Default_error_models() -> std::vector<Error_model>
+{
+    return { Err_pre_model(), Err_pre_approx_model(), Err_pre_base_model(), Err_pre_scaled_model() };
+}
+
+auto Fit_model(const Error_model& model, const Model_data& data, bool is_fitting) -> Model_summary
+{
+    constexpr unsigned int max_iterations = 200;
+    constexpr double tolerance = 1e-10;
+    constexpr double max_damping = 1e12;
+
+    auto least_squares = Least_squares{ model, data };
+    auto summary = Model_summary{};
+    summary.name = model.name;
+    summary.parameters = model.parameters;
+    const auto pars_num = is_fitting ? model.parameters.size() : 0;
+    const auto points_num = least_squares.GetPointsNum();
+    summary.ndf = (points_num > pars_num) ? points_num - pars_num : 0;
+    summary.parameter_errors.assign(model.parameters.size(), 0.);
+    summary.chi2 = least_squares.Chi2(summary.parameters);
+    if (pars_num == 0 || points_num == 0)
+    {
+        return summary;
+    }
+
+    auto curvature = Matrix{};
+    auto gradient = std::vector<double>{};
+    auto damping = 1e-3;
+    least_squares.Linearize(summary.parameters, curvature, gradient);
+    while (summary.iterations < max_iterations && damping < max_damping)
+    {
+        ++summary.iterations;
+        auto damped = curvature;
+        for (std::size_t par{}; par < pars_num; ++par)
+        {
+            damped[par][par] *= 1 + damping;
+        }
+        const auto step = Solve_linear(std::move(damped), gradient);
+        if (!step.has_value())
+        {
+            damping *= 10;
+            continue;
+        }
+        auto trial = summary.parameters;
+        for (std::size_t par{}; par < pars_num; ++par)
+        {
+            trial[par] += (*step)[par];
+        }
+        const auto chi2 = least_squares.Chi2(trial);
+        if (!(chi2 < summary.chi2))
+        {
+            damping *= 10;
+            continue;
+        }
+        const auto is_converged = summary.chi2 - chi2 <= tolerance * std::max(chi2, 1.);
+        summary.parameters = std::move(trial);
+        summary.chi2 = chi2;
+        damping = std::max(damping / 10, 1e-12);
+        if (is_converged)
+        {
+            break;
+        }
+        least_squares.Linearize(summary.parameters, curvature, gradient);
+    }
+
+    summary.chi2 = least_squares.Chi2(summary.parameters);
+    least_squares.Linearize(summary.parameters, curvature, gradient);
+    for (std::size_t par{}; par < pars_num; ++par)
+    {
+        auto unit = std::vector<double>(pars_num, 0.);
+        unit[par] = 1.;
+        const auto column = Solve_linear(curvature, std::move(unit));
+        summary.parameter_errors[par] =
+            column.has_value() ? std::sqrt((*column)[par]) : std::numeric_limits<double>::quiet_NaN();
+    }
+    return summary;
+}
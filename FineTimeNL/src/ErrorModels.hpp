@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+// parameter point of a sweep in the variables of the error models
+struct Model_point
+{
+    double pa = 0.;
+    double pb = 0.;
+    double entryN = 0.;
+};
+
+// Analytic standard deviation of the position inside the central bin. evaluate fills the values of all points for
+// one set of the free parameters, which start from the values given here. A model without parameters is only
+// evaluated, not fitted.
+struct Error_model
+{
+    using Evaluation = std::function<void(std::span<const Model_point>, std::span<const double>, std::span<double>)>;
+
+    std::string name;
+    Evaluation evaluate;
+    std::vector<double> parameters;
+};
+
+// model from a function of a single point and the parameters
+template <typename Function>
+auto Pointwise_model(std::string name, Function function, std::vector<double> parameters = {}) -> Error_model
+{
+    auto evaluate = [function = std::move(function)](
+                        std::span<const Model_point> points, std::span<const double> pars, std::span<double> values)
+    {
+        for (std::size_t index{}; index < points.size(); ++index)
+        {
+            values[index] = function(points[index], pars);
+        }
+    };
+    return Error_model{ .name = std::move(name), .evaluate = std::move(evaluate), .parameters = std::move(parameters) };
+}
+
+// the models of plot_err.py
+auto Err_pre_model() -> Error_model;
+auto Err_pre_approx_model() -> Error_model;
+auto Err_pre_base_model() -> Error_model;
+// err_pre with free factors in front of its N^2 and its N term, both 1 for err_pre
+auto Err_pre_scaled_model() -> Error_model;
+auto Default_error_models() -> std::vector<Error_model>;
+
+// measured errors with their uncertainties, points with sigma 0 are not part of the fit and the chi2
+struct Model_data
+{
+    std::vector<Model_point> points;
+    std::vector<double> values;
+    std::vector<double> sigmas;
+};
+
+struct Model_summary
+{
+    std::string name;
+    std::vector<double> parameters;
+    std::vector<double> parameter_errors;
+    double chi2 = 0.;
+    std::size_t ndf = 0;
+    unsigned int iterations = 0;
+};
+
+// Weighted least squares fit of the free parameters with Levenberg-Marquardt and a central difference Jacobian, or
+// only the chi2 at the given parameters without is_fitting. The parameter errors are from the inverse of J^T J.
+auto Fit_model(const Error_model& model, const Model_data& data, bool is_fitting) -> Model_summary;
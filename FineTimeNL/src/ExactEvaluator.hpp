@@ -0,0 +1,65 @@
+#pragma once
+
+#include "traits.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// log of the binomial pmf B(trials, prob) at value
+inline auto LogBinomialPmf(unsigned int value, unsigned int trials, double prob) -> double
+{
+    if (prob <= 0.)
+    {
+        return (value == 0) ? 0. : -INFINITY;
+    }
+    if (prob >= 1.)
+    {
+        return (value == trials) ? 0. : -INFINITY;
+    }
+    return std::lgamma(trials + 1.) - std::lgamma(value + 1.) - std::lgamma(trials - value + 1.) +
+           value * std::log(prob) + (trials - value) * std::log1p(-prob);
+}
+
+// Mean and standard deviation of the value UniformInserter fills, X = A + U * B with (A, B, C) ~ M(N; pa, pb, pc)
+// and U ~ U(0, 1), conditional on B > 0 as empty central bins are skipped. Given B = b the first bin follows
+// B(N - b, pa / (1 - pb)), so both moments are sums over b with O(N) terms. Terms further than 40 standard
+// deviations from the mode of B are below double precision and skipped.
+inline auto GetExactMeanError(const std::array<double, 3>& distribution, unsigned int entryN) -> MeanError
+{
+    const auto mid_prob = distribution[1];
+    // clamped like BinomialSampler::SetProb, pa + pb > 1 is sampled with pc = 0
+    const auto pre_prob = (mid_prob < 1.) ? std::clamp(distribution[0] / (1. - mid_prob), 0., 1.) : 0.;
+
+    constexpr double window_sigmas = 40.;
+    const auto mode = entryN * mid_prob;
+    const auto window = window_sigmas * (std::sqrt(mode * (1. - mid_prob)) + 1.);
+    const auto mid_begin = static_cast<unsigned int>(std::max(1., std::floor(mode - window)));
+    const auto mid_end = static_cast<unsigned int>(std::min(static_cast<double>(entryN), std::ceil(mode + window)));
+
+    auto total_weight = 0.;
+    auto mean = 0.;
+    for (auto mid_num = mid_begin; mid_num <= mid_end; ++mid_num)
+    {
+        const auto weight = std::exp(LogBinomialPmf(mid_num, entryN, mid_prob));
+        const auto pre_mean = (entryN - mid_num) * pre_prob;
+        total_weight += weight;
+        mean += weight * (pre_mean + mid_num / 2.);
+    }
+    if (total_weight == 0.)
+    {
+        return {};
+    }
+    mean /= total_weight;
+
+    // Var(X | b) = Var(A | b) + b^2 / 12, and the spread of the conditional means around the mean
+    auto variance = 0.;
+    for (auto mid_num = mid_begin; mid_num <= mid_end; ++mid_num)
+    {
+        const auto weight = std::exp(LogBinomialPmf(mid_num, entryN, mid_prob));
+        const auto pre_num = static_cast<double>(entryN - mid_num);
+        const auto deviation = pre_num * pre_prob + mid_num / 2. - mean;
+        variance += weight * (pre_num * pre_prob * (1. - pre_prob) + mid_num * mid_num / 12. + deviation * deviation);
+    }
+    variance /= total_weight;
+    return MeanError{ static_cast<float>(mean), static_cast<float>(std::sqrt(variance)) };
+}
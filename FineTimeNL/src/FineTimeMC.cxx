@@ -1,4 +1,7 @@
 #include "FineTimeMC.hpp"
+#include <algorithm>
+#include <iterator>
+#include <numeric>
 
 auto Divide_into(unsigned int totalSize, unsigned int num_of_threads) -> std::vector<unsigned int>
 {
@@ -15,34 +18,593 @@ auto Divide_into(unsigned int totalSize, unsigned int num_of_threads) -> std::ve
     return vec;
 }
 
-void FineTimeMC::SetThreadsNum(unsigned int num)
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetThreadsNum(unsigned int num)
 {
     threads_num_ = num;
 }
 
-void FineTimeMC::SetRndNumber(unsigned int num)
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetRndNumber(unsigned int num)
 {
+    if (num == 0)
+    {
+        throw std::logic_error("the number of random values has to be positive!");
+    }
     default_epoch_input_.rndNum = num;
 }
 
-void FineTimeMC::SetEntryN(unsigned int size)
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetEntryN(unsigned int size)
 {
     entryN_ = size;
     default_epoch_input_.entryN = size;
 }
 
-void FineTimeMC::Wait()
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetInserterMode(InserterMode mode)
+{
+    inserter_mode_ = mode;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Run_point(const Parallel_run_input& input,
+                                    const Distribution& distribution,
+                                    InserterMode mode) const
+{
+    auto inserter = UniformInserter{ input.entryN, mode, histogram_pool_.get() };
+    auto multinomial = MultiNomial<BinSize>(inserter.GetEngine());
+    Single_run(distribution, multinomial, inserter, input);
+}
+
+// the shards are merged in their order and not in the order they finish, which keeps the moments reproducible
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Run_shard(const Parallel_run_input& input,
+                                    const Distribution& distribution,
+                                    Point_shards& shards,
+                                    std::size_t index) const
+{
+    auto inserter = UniformInserter{ input.entryN, InserterMode::histogram, histogram_pool_.get() };
+    auto multinomial = MultiNomial<BinSize>(inserter.GetEngine());
+    auto result = Sample(distribution, multinomial, inserter, input);
+    shards.histograms[index] = inserter.ReleaseHist();
+    shards.replicates[index] = inserter.GetReplicates();
+    shards.sampleN += result.sampleN;
+    if (--shards.remaining > 0)
+    {
+        return;
+    }
+
+    auto histogram = std::move(shards.histograms.front());
+    auto replicates = shards.replicates.front();
+    for (std::size_t shard = 1; shard < shards.histograms.size(); ++shard)
+    {
+        histogram->Merge(*shards.histograms[shard]);
+        shards.histograms[shard].reset();
+        replicates.Merge(shards.replicates[shard]);
+    }
+    const auto& stat = histogram->GetStat();
+    result.stat = MeanError{ static_cast<float>(stat.GetMean()),
+                             static_cast<float>(stat.GetStdDev()),
+                             static_cast<float>(GetMeanError(input.sampling, stat, replicates)) };
+    result.sampleN = shards.sampleN;
+    result.filledN = static_cast<unsigned int>(stat.GetCount());
+    Telemetry::Add(Counter::points, 1);
+    auto timer = PhaseTimer{ Phase::record };
+    Record(input, std::move(result), std::move(histogram));
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Run_exact_point(const Parallel_run_input& input, const Distribution& distribution) const
+{
+    const auto aggregated = Aggregate(distribution);
+    auto result = Parallel_run_output{};
+    result.stat = GetExactMeanError(aggregated, input.entryN);
+    result.pre_prob = aggregated[0];
+    result.mid_prob = aggregated[1];
+    result.post_prob = aggregated[2];
+    result.entryN = input.entryN;
+    Record(input, std::move(result), nullptr);
+}
+
+// Runs entryN, ..., entryN + sizes_num - 1 on the same samples. A sample starts with the full multinomial draw of
+// the first entryN, the same as in the monte_carlo engine, and every further entryN adds one categorical trial to it.
+// A step thus costs O(rndNum), and the samples keep their in-bin positions, which correlates neighbouring points
+// positively and smooths the curve. Each batch of samples is carried through all sizes while its counts are in cache.
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Run_incremental_block(const Parallel_run_input& input,
+                                                const Distribution& distribution,
+                                                unsigned int sizes_num) const
+{
+    auto inputs = std::vector<Parallel_run_input>(sizes_num, input);
+    auto is_restored = std::vector<bool>(sizes_num);
+    for (unsigned int step{}; step < sizes_num; ++step)
+    {
+        inputs[step].entryN = input.entryN + step;
+        inputs[step].stream = StreamKey(StreamTag::entryN, inputs[step].entryN);
+        is_restored[step] = Restore(inputs[step], distribution);
+    }
+    if (std::ranges::all_of(is_restored, [](bool restored) { return restored; }))
+    {
+        return;
+    }
+
+    auto engine = CounterEngine{ SEED_NUM, input.stream };
+    auto multinomial = MultiNomial<BinSize>(&engine);
+    multinomial.SetEntryN(input.entryN);
+    multinomial.SetDistribution(distribution);
+    auto trial_engines = std::array<CounterEngine, SAMPLE_BATCH_SIZE>{};
+    for (auto& trial_engine : trial_engines)
+    {
+        trial_engine = CounterEngine{ SEED_NUM, StreamKey(StreamTag::entryN_step, input.entryN) };
+    }
+    auto cumulative = Distribution{};
+    std::partial_sum(distribution.begin(), distribution.end(), cumulative.begin());
+    auto inserters = std::vector<UniformInserter>{};
+    inserters.reserve(sizes_num);
+    for (unsigned int step{}; step < sizes_num; ++step)
+    {
+        inserters.emplace_back(inputs[step].entryN, inserter_mode_, histogram_pool_.get());
+        inserters.back().SetSamplingMode(input.sampling);
+    }
+
+    const auto replicate = GetReplicateSize(input.sampling);
+    const auto rndNum = (input.rndNum + replicate - 1) / replicate * replicate;
+    constexpr auto EMPTY_ENTRIES = std::array<unsigned int, BinSize>{};
+    auto entries = std::array<std::array<unsigned int, BinSize>, SAMPLE_BATCH_SIZE>{};
+    auto positions = BatchArray<double>{};
+    auto batch = SampleBatch{};
+    for (uint64_t first{}; first < rndNum; first += SAMPLE_BATCH_SIZE)
+    {
+        batch.first_sample = first;
+        batch.size = std::min<std::size_t>(SAMPLE_BATCH_SIZE, rndNum - first);
+        FillSampleUniforms(engine.GetKey(), engine.GetStream(), first, positions);
+        if (input.sampling != SamplingMode::plain)
+        {
+            TransformSampleUniforms(input.sampling, positions);
+        }
+        for (unsigned int step{}; step < sizes_num; ++step)
+        {
+            {
+                auto timer = PhaseTimer{ Phase::draw };
+                for (std::size_t lane{}; lane < batch.size; ++lane)
+                {
+                    if (step == 0)
+                    {
+                        engine.SetSample(first + lane);
+                        multinomial.RandomFill(entries[lane]);
+                        trial_engines[lane].SetSample(first + lane);
+                    }
+                    else
+                    {
+                        const auto uniform = trial_engines[lane].Rndm();
+                        const auto bin = std::ranges::upper_bound(cumulative, uniform) - cumulative.begin();
+                        ++entries[lane][std::min<std::size_t>(bin, BinSize - 1)];
+                    }
+                }
+                for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+                {
+                    SetBatchCounts(batch, lane, (lane < batch.size) ? entries[lane] : EMPTY_ENTRIES);
+                }
+            }
+            if (!is_restored[step])
+            {
+                auto timer = PhaseTimer{ Phase::insert };
+                inserters[step].Insert_batch(batch, positions);
+            }
+        }
+    }
+
+    const auto aggregated = Aggregate(distribution);
+    for (unsigned int step{}; step < sizes_num; ++step)
+    {
+        if (is_restored[step])
+        {
+            continue;
+        }
+        auto result = Parallel_run_output{};
+        result.stat = inserters[step].GetResult();
+        result.pre_prob = aggregated[0];
+        result.mid_prob = aggregated[1];
+        result.post_prob = aggregated[2];
+        result.entryN = inputs[step].entryN;
+        result.sampleN = rndNum;
+        result.filledN = static_cast<unsigned int>(inserters[step].GetStat().GetCount());
+        Telemetry::Add(Counter::samples, rndNum);
+        Telemetry::Add(Counter::points, 1);
+        auto timer = PhaseTimer{ Phase::record };
+        Record(inputs[step], std::move(result), inserters[step].ReleaseHist());
+    }
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Run_sweep_point(const Parallel_run_input& input, const Distribution& distribution) const
+{
+    if (Restore(input, distribution))
+    {
+        return;
+    }
+    if (engine_mode_ == EngineMode::exact)
+    {
+        Run_exact_point(input, distribution);
+        return;
+    }
+    Run_point(input, distribution, inserter_mode_);
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Record(const Parallel_run_input& input,
+                                 Parallel_run_output output,
+                                 HistogramHandle histogram) const
+{
+    if (checkpoint_ != nullptr && histogram == nullptr)
+    {
+        checkpoint_->Add(input.writer_index, input.stream, output);
+    }
+    Queue_record(input, std::move(output), std::move(histogram));
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Queue_record(const Parallel_run_input& input,
+                                       Parallel_run_output output,
+                                       HistogramHandle histogram) const
+{
+    auto record = Run_record{};
+    record.writer_index = input.writer_index;
+    record.task = input.task;
+    record.order = input.stream;
+    record.output = std::move(output);
+    record.output.histogram = std::move(histogram);
+    output_->Push(std::move(record));
+}
+
+// a checkpointed point is restored instead of being run, provided it describes the same parameters
+template <std::size_t BinSize>
+auto FineTimeMC<BinSize>::Restore(const Parallel_run_input& input, const Distribution& distribution) const -> bool
+{
+    if (checkpoint_ == nullptr)
+    {
+        return false;
+    }
+    const auto* output = checkpoint_->Find(input.writer_index, input.stream);
+    if (output == nullptr)
+    {
+        return false;
+    }
+    const auto aggregated = Aggregate(distribution);
+    if (output->entryN != input.entryN || output->pre_prob != static_cast<float>(aggregated[0]) ||
+        output->mid_prob != static_cast<float>(aggregated[1]) ||
+        output->post_prob != static_cast<float>(aggregated[2]))
+    {
+        throw std::logic_error(
+            fmt::format("checkpoint {} was written for a different sweep!", checkpoint_filename_));
+    }
+    Queue_record(input, output->CopyWithoutHistogram(), nullptr);
+    return true;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetCheckpoint(std::string_view filename, bool is_resumed, std::chrono::seconds flush_interval)
+{
+    checkpoint_filename_ = filename;
+    is_resumed_ = is_resumed;
+    checkpoint_interval_ = flush_interval;
+}
+
+// opened with the first sweep so that the signature sees the final settings
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Open_checkpoint()
+{
+    if (checkpoint_ != nullptr || checkpoint_filename_.empty())
+    {
+        return;
+    }
+    const auto signature = Checkpoint::Signature{ .seed = SEED_NUM,
+                                                  .entryN = default_epoch_input_.entryN,
+                                                  .rndNum = default_epoch_input_.rndNum,
+                                                  .engine_mode = static_cast<int>(engine_mode_),
+                                                  .precision = default_epoch_input_.precision.relative_error,
+                                                  .block_size = default_epoch_input_.precision.block_size,
+                                                  .bins = BinSize,
+                                                  .sampling = static_cast<int>(default_epoch_input_.sampling),
+                                                  .is_conditioned = default_epoch_input_.is_conditioned ? 1 : 0 };
+    checkpoint_ = std::make_unique<Checkpoint>(checkpoint_filename_, signature, is_resumed_);
+    checkpoint_->SetFlushInterval(checkpoint_interval_);
+}
+
+template <std::size_t BinSize>
+auto FineTimeMC<BinSize>::GetPool() -> TaskPool&
+{
+    const auto workers_num = std::max(threads_num_, 1U);
+    if (pool_ == nullptr || pool_->GetWorkersNum() != workers_num)
+    {
+        if (pool_ != nullptr)
+        {
+            pool_->Wait();
+        }
+        pool_.reset();
+        pool_ = std::make_unique<TaskPool>(workers_num);
+    }
+    return *pool_;
+}
+
+// Initial placement in contiguous blocks like the former static split, the workers balance it by stealing. Ordered
+// output deals the tasks out round robin instead, so that the workers run them about in sweep order and few results
+// wait for an earlier task. Every task then queues its end behind its results, and the task finishing last queues
+// the end of the sweep.
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Schedule(std::vector<TaskPool::Task> tasks, std::size_t writer_index)
+{
+    const auto first_task = Select_shard(tasks);
+    if (tasks.empty())
+    {
+        return;
+    }
+    Open_checkpoint();
+    if (output_ == nullptr)
+    {
+        output_ = std::make_unique<OutputStage<Output_item>>([this](Output_item& item) { Consume_output(item); },
+                                                             OUTPUT_QUEUE_CAPACITY);
+    }
+    const auto is_ordered = Is_ordered_output();
+    auto remaining = std::make_shared<std::atomic<std::size_t>>(tasks.size());
+    for (std::size_t position{}; position < tasks.size(); ++position)
+    {
+        auto& task = tasks[position];
+        const auto task_end = Task_end{ .writer_index = writer_index,
+                                        .task = first_task + position,
+                                        .first_task = first_task };
+        task = [task = std::move(task), remaining, task_end, is_ordered, this](unsigned int worker)
+        {
+            task(worker);
+            if (is_ordered)
+            {
+                output_->Push(task_end);
+            }
+            if (--*remaining == 0)
+            {
+                output_->Push(Sweep_end{ task_end.writer_index });
+            }
+        };
+    }
+    auto& pool = GetPool();
+    if (is_ordered)
+    {
+        for (std::size_t position{}; position < tasks.size(); ++position)
+        {
+            pool.Submit(std::move(tasks[position]), static_cast<unsigned int>(position % pool.GetWorkersNum()));
+        }
+        return;
+    }
+    auto blocks = Divide_into(tasks.size(), pool.GetWorkersNum());
+    auto task = tasks.begin();
+    for (unsigned int queue_index{}; queue_index < blocks.size(); ++queue_index)
+    {
+        for (unsigned int count{}; count < blocks[queue_index]; ++count, ++task)
+        {
+            pool.Submit(std::move(*task), queue_index);
+        }
+    }
+}
+
+// the tasks are in sweep order, and a shard keeps the same block of them in every process
+template <std::size_t BinSize>
+auto FineTimeMC<BinSize>::Select_shard(std::vector<TaskPool::Task>& tasks) const -> std::size_t
 {
-    for (auto& future : all_thread_results_)
+    if (shard_count_ <= 1 || tasks.empty())
+    {
+        return 0;
+    }
+    const auto blocks = Divide_into(tasks.size(), shard_count_);
+    if (shard_index_ >= blocks.size())
     {
-        future.get();
+        tasks.clear();
+        return 0;
     }
+    const auto first = std::accumulate(blocks.begin(), blocks.begin() + shard_index_, std::size_t{});
+    tasks.erase(tasks.begin() + static_cast<std::ptrdiff_t>(first + blocks[shard_index_]), tasks.end());
+    tasks.erase(tasks.begin(), tasks.begin() + static_cast<std::ptrdiff_t>(first));
+    return first;
+}
+
+// shard outputs are always sorted, so that they concatenate to the sorted output of the whole sweep
+template <std::size_t BinSize>
+auto FineTimeMC<BinSize>::Is_ordered_output() const -> bool
+{
+    return is_sorted_output_ || shard_count_ > 1;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetShard(unsigned int index, unsigned int count)
+{
+    if (count == 0 || index >= count)
+    {
+        throw std::logic_error(fmt::format("shard {}/{} does not exist!", index, count));
+    }
+    shard_index_ = index;
+    shard_count_ = count;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetWriteOnCompletion(bool is_eager)
+{
+    is_write_on_completion_ = is_eager;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetSortedOutput(bool is_sorted)
+{
+    is_sorted_output_ = is_sorted;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetEngineMode(EngineMode mode)
+{
+    engine_mode_ = mode;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetPrecisionTarget(const Precision_target& target)
+{
+    default_epoch_input_.precision = target;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetConditioned(bool is_conditioned)
+{
+    default_epoch_input_.is_conditioned = is_conditioned;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::SetSamplingMode(SamplingMode mode)
+{
+    default_epoch_input_.sampling = mode;
 }
 
-void FineTimeMC::Write()
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Wait()
 {
-    for (auto* writer : writers_)
+    if (pool_ != nullptr)
     {
-        writer->write();
+        pool_->Wait();
     }
+    if (checkpoint_ != nullptr)
+    {
+        checkpoint_->Flush();
+    }
+    if (output_ != nullptr)
+    {
+        output_->Drain();
+    }
+}
+
+template <std::size_t BinSize>
+auto FineTimeMC<BinSize>::GetWriterSlot(std::size_t writer_index) -> Writer_slot&
+{
+    auto lock = std::scoped_lock{ mu_writers_ };
+    return writers_[writer_index];
 }
+
+// runs on the output thread: results go to the write strategies in completion order, or with ordered output in the
+// order of their tasks, each task's results sorted by the sweep parameter
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Consume_output(Output_item& item)
+{
+    if (auto* record = std::get_if<Run_record>(&item); record != nullptr)
+    {
+        auto& slot = GetWriterSlot(record->writer_index);
+        if (Is_ordered_output())
+        {
+            slot.pending[record->task].emplace_back(std::move(*record));
+            return;
+        }
+        auto timer = PhaseTimer{ Phase::flush };
+        Hand_over(slot, record->output);
+        return;
+    }
+    if (const auto* task_end = std::get_if<Task_end>(&item); task_end != nullptr)
+    {
+        End_task(GetWriterSlot(task_end->writer_index), *task_end);
+        return;
+    }
+    auto& slot = GetWriterSlot(std::get<Sweep_end>(item).writer_index);
+    Hand_over_pending(slot);
+    if (is_write_on_completion_)
+    {
+        slot.writer->write();
+        slot.is_written = true;
+    }
+}
+
+// hands over the results of every task whose predecessors have all ended
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::End_task(Writer_slot& slot, const Task_end& task_end)
+{
+    if (!slot.is_window_open)
+    {
+        slot.next_task = task_end.first_task;
+        slot.is_window_open = true;
+    }
+    slot.ended_tasks.insert(task_end.task);
+    auto timer = PhaseTimer{ Phase::flush };
+    while (!slot.ended_tasks.empty() && *slot.ended_tasks.begin() == slot.next_task)
+    {
+        slot.ended_tasks.erase(slot.ended_tasks.begin());
+        if (auto records = slot.pending.find(slot.next_task); records != slot.pending.end())
+        {
+            Hand_over_task(slot, records->second);
+            slot.pending.erase(records);
+        }
+        ++slot.next_task;
+    }
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Hand_over_task(Writer_slot& slot, std::vector<Run_record>& records)
+{
+    std::ranges::sort(records, {}, &Run_record::order);
+    for (auto& record : records)
+    {
+        Hand_over(slot, record.output);
+    }
+}
+
+// whatever the window still holds at the end of a sweep, and closes the window for the next sweep
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Hand_over_pending(Writer_slot& slot)
+{
+    auto timer = PhaseTimer{ Phase::flush };
+    for (auto& [task, records] : slot.pending)
+    {
+        Hand_over_task(slot, records);
+    }
+    slot.pending.clear();
+    slot.ended_tasks.clear();
+    slot.is_window_open = false;
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Hand_over(Writer_slot& slot, Parallel_run_output& result)
+{
+    slot.strategy(result);
+    for (const auto& strategy : observer_strategies_)
+    {
+        strategy(result);
+    }
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Write()
+{
+    auto lock = std::scoped_lock{ mu_writers_ };
+    for (auto& slot : writers_)
+    {
+        if (slot.writer == nullptr || slot.is_written)
+        {
+            continue;
+        }
+        Hand_over_pending(slot);
+        slot.writer->write();
+    }
+    for (auto* observer : observers_)
+    {
+        observer->write();
+    }
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Unregister(const Sinker& writer)
+{
+    auto lock = std::scoped_lock{ mu_writers_ };
+    for (auto& slot : writers_)
+    {
+        if (slot.writer == &writer)
+        {
+            slot = Writer_slot{};
+        }
+    }
+}
+
+template class FineTimeMC<3>;
+template class FineTimeMC<5>;
+template class FineTimeMC<7>;
@@ -1,182 +1,459 @@
 #pragma once
 
+#include "Checkpoint.hpp"
 #include "DistributionGen.hpp"
+#include "ExactEvaluator.hpp"
+#include "HistogramPool.hpp"
 #include "MultiNomial.hpp"
+#include "OutputStage.hpp"
 #include "Sinker.hpp"
+#include "TaskPool.hpp"
+#include "Telemetry.hpp"
 #include "UniformInserter.hpp"
 #include "traits.hpp"
 #include <fmt/core.h>
 #include <fmt/std.h>
-#include <future>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <map>
 #include <range/v3/view.hpp>
+#include <set>
+#include <variant>
 #include <vector>
 
-constexpr unsigned int BINSIZE = 3;
+constexpr std::size_t BINSIZE = 3; // default number of bins
+
+enum class EngineMode
+{
+    monte_carlo,
+    exact,      // closed form sums, see GetExactMeanError
+    incremental // entryN sweeps reuse the samples of the previous entryN, see Run_incremental_block
+};
+
+constexpr unsigned int INCREMENTAL_BLOCK = 16; // consecutive entryN values sharing their samples
+
 template <typename T>
 concept Loopable = requires(T loopOp) {
                        loopOp.Init();
                        loopOp.Reset();
                    };
 
+// result of one parameter point, on its way from the worker that computed it to the writer
+struct Run_record
+{
+    std::size_t writer_index = 0;
+    std::size_t task = 0; // position of the task that computed it in the sweep
+    uint64_t order = 0;   // position among the results of that task
+    Parallel_run_output output;
+};
+
+// queued after the results of a task of a sweep with ordered output, first_task is the first task of the shard
+struct Task_end
+{
+    std::size_t writer_index = 0;
+    std::size_t task = 0;
+    std::size_t first_task = 0;
+};
+
+// queued after the last result of a sweep
+struct Sweep_end
+{
+    std::size_t writer_index = 0;
+};
+
+using Output_item = std::variant<Run_record, Task_end, Sweep_end>;
+
+constexpr std::size_t OUTPUT_QUEUE_CAPACITY = 1024; // results waiting for the output thread before workers block
+
+// histograms of a point whose samples are split over several tasks, merged by the shard finishing last
+struct Point_shards
+{
+    explicit Point_shards(std::size_t num)
+        : histograms(num)
+        , replicates(num)
+        , remaining{ num }
+    {
+    }
+    std::vector<HistogramHandle> histograms;
+    std::vector<ReplicateStat> replicates;
+    std::atomic<unsigned int> sampleN = 0;
+    std::atomic<std::size_t> remaining;
+};
+
+constexpr unsigned int SHARD_SAMPLES = 1U << 16; // samples above which a histogram point is split into shards
+
 auto Divide_into(unsigned int totalSize, unsigned int num_of_threads) -> std::vector<unsigned int>;
 
+// The bin count is a compile time parameter, the sweeps keep describing the points by the aggregated probabilities
+// before, of and after the central bin and spread them evenly over the side bins (see Expand).
+template <std::size_t BinSize = BINSIZE>
 class FineTimeMC
 {
   public:
+    static_assert(BinSize % 2 == 1 && BinSize >= 3, "the central bin needs an odd number of bins");
+    using Distribution = std::array<double, BinSize>;
+
     FineTimeMC() = default;
 
     void SetThreadsNum(unsigned int num);
     void SetRndNumber(unsigned int num);
     void SetEntryN(unsigned int size);
+    void SetInserterMode(InserterMode mode);
+    void SetSortedOutput(bool is_sorted);
+    void SetEngineMode(EngineMode mode);
+    void SetPrecisionTarget(const Precision_target& target);
+    // rndNum is rounded up to whole replicates, see GetReplicateSize
+    void SetSamplingMode(SamplingMode mode);
+    // Draws conditioned on a nonzero central bin, see CentralMultinomialSampler::SetConditioned. No sample is
+    // skipped, which pays off for small pb, and the histograms carry the importance weight. Not for the incremental
+    // engine.
+    void SetConditioned(bool is_conditioned);
+    // finished points are recorded in the file, and with is_resumed the points found in it are not run again
+    void SetCheckpoint(std::string_view filename, bool is_resumed, std::chrono::seconds flush_interval);
+    // Runs only the index-th of count contiguous blocks of every sweep, see Divide_into. The rows are written sorted,
+    // so the outputs of shards 0 .. count - 1 concatenate to the sorted output of the whole sweep.
+    void SetShard(unsigned int index, unsigned int count);
+    // the writer of a sweep writes its file on the output thread as soon as the sweep has completed, instead of in
+    // Write
+    void SetWriteOnCompletion(bool is_eager);
+    // Every result is passed on to the observers after the writer of its sweep, e.g. to a HistCollector taking the
+    // histograms over or to a ModelChecker. They are written by Write. Sweeps fill histograms only with
+    // InserterMode::histogram.
+    void AddObserver(auto& observer);
 
     void RunFixedPbAllEntryN(double midProb, int min, int max, auto& writer);
     void RunFixedPbAllPa(double midProb, double min, double max, unsigned int num, auto& writer);
-    void RunWithAllFixed(std::array<double, 3> distribution, auto& writer);
+    void RunWithAllFixed(std::array<double, 3> aggregated, auto& writer);
+    // full Cartesian product of the axes, points with pa + pb > 1 are skipped
+    void RunGrid(const Grid_axis& pa_axis, const Grid_axis& pb_axis, const Grid_axis& entryN_axis, auto& writer);
 
+    // blocks until the scheduled sweeps are computed and their results handed to the writers
     void Wait();
+    // writes the files the output thread has not written yet
     void Write();
+    // drops every slot of the writer, after Wait, so that a writer serving many sweeps does not grow the slots
+    void Unregister(const Sinker& writer);
 
   private:
     unsigned int entryN_ = 0;
     unsigned int rndNums_ = 0;
     unsigned int threads_num_ = 1;
+    InserterMode inserter_mode_ = InserterMode::statistics;
+    EngineMode engine_mode_ = EngineMode::monte_carlo;
     Parallel_run_input default_epoch_input_ = {};
-    mutable std::atomic<int> threads_count_ = 0;
-    DisGenerator<BINSIZE> dis_generator_;
-    mutable std::vector<Sinker*> writers_;
-    std::vector<std::future<void>> all_thread_results_;
-    mutable std::mutex mu_recorder_;
-
-    void Single_run(const std::array<double, 3>& distribution,
-                    MultiNomial& multinomial,
+    DisGenerator<BinSize> dis_generator_;
+    bool is_sorted_output_ = false;
+    bool is_write_on_completion_ = false;
+
+    // Results reach the writers through a single output thread, which runs the write strategies and, with
+    // is_write_on_completion_, writes the files while the workers compute the next points. With ordered output the
+    // results of a task wait in pending until all tasks before it have ended, which keeps only the results of the
+    // tasks running out of order. The window and is_written are only touched by that thread, or after Wait.
+    struct Writer_slot
+    {
+        Sinker* writer = nullptr;
+        std::function<void(Parallel_run_output&)> strategy;
+        std::map<std::size_t, std::vector<Run_record>> pending; // by task
+        std::set<std::size_t> ended_tasks;                      // ended tasks after next_task
+        std::size_t next_task = 0;
+        bool is_window_open = false;
+        bool is_written = false;
+    };
+    // a deque keeps the slots in place while new writers are registered, slots without a writer are reused
+    std::deque<Writer_slot> writers_;
+    mutable std::mutex mu_writers_;
+    std::vector<Sinker*> observers_;
+    std::vector<std::function<void(Parallel_run_output&)>> observer_strategies_;
+    std::shared_ptr<HistogramPool> histogram_pool_ = HistogramPool::Create();
+    std::unique_ptr<OutputStage<Output_item>> output_;
+    std::unique_ptr<TaskPool> pool_;
+    std::string checkpoint_filename_;
+    bool is_resumed_ = false;
+    std::chrono::seconds checkpoint_interval_{};
+    std::unique_ptr<Checkpoint> checkpoint_;
+    unsigned int shard_index_ = 0;
+    unsigned int shard_count_ = 1;
+
+    auto Sample(const Distribution& distribution,
+                MultiNomial<BinSize>& multinomial,
+                auto& inserter,
+                const Parallel_run_input& input) const -> Parallel_run_output;
+    void Single_run(const Distribution& distribution,
+                    MultiNomial<BinSize>& multinomial,
                     auto& inserter,
-                    auto& recorder,
                     const Parallel_run_input& input) const;
-    void Parallel_run_all_cycles(Parallel_run_input input,
-                                 const std::array<double, 3>& distribution,
-                                 auto& inserter,
-                                 auto& writer) const;
-    void Parallel_run_pre(Parallel_run_input input, double mid_prob, auto& inserter, auto& writer) const;
+    void Run_point(const Parallel_run_input& input, const Distribution& distribution, InserterMode mode) const;
+    void Run_shard(const Parallel_run_input& input,
+                   const Distribution& distribution,
+                   Point_shards& shards,
+                   std::size_t index) const;
+    void Run_exact_point(const Parallel_run_input& input, const Distribution& distribution) const;
+    void Run_incremental_block(const Parallel_run_input& input,
+                               const Distribution& distribution,
+                               unsigned int sizes_num) const;
+    void Record(const Parallel_run_input& input,
+                Parallel_run_output output,
+                HistogramHandle histogram) const;
+    void Queue_record(const Parallel_run_input& input,
+                      Parallel_run_output output,
+                      HistogramHandle histogram) const;
+    auto Restore(const Parallel_run_input& input, const Distribution& distribution) const -> bool;
+    void Run_sweep_point(const Parallel_run_input& input, const Distribution& distribution) const;
+    auto Register_writer(auto& writer) -> std::size_t;
+    auto GetPool() -> TaskPool&;
+    void Open_checkpoint();
+    auto GetWriterSlot(std::size_t writer_index) -> Writer_slot&;
+    void Schedule(std::vector<TaskPool::Task> tasks, std::size_t writer_index);
+    // returns the position of the first task kept
+    auto Select_shard(std::vector<TaskPool::Task>& tasks) const -> std::size_t;
+    [[nodiscard]] auto Is_ordered_output() const -> bool;
+    void Consume_output(Output_item& item);
+    void End_task(Writer_slot& slot, const Task_end& task_end);
+    void Hand_over(Writer_slot& slot, Parallel_run_output& result);
+    void Hand_over_task(Writer_slot& slot, std::vector<Run_record>& records);
+    void Hand_over_pending(Writer_slot& slot);
 };
 
-void FineTimeMC::Single_run(const std::array<double, 3>& distribution,
-                            MultiNomial& multinomial,
-                            auto& inserter,
-                            auto& writer,
-                            const Parallel_run_input& input) const
+template <std::size_t BinSize>
+auto FineTimeMC<BinSize>::Sample(const Distribution& distribution,
+                                 MultiNomial<BinSize>& multinomial,
+                                 auto& inserter,
+                                 const Parallel_run_input& input) const -> Parallel_run_output
 {
+    const auto replicate = static_cast<unsigned int>(GetReplicateSize(input.sampling));
+    inserter.GetEngine()->SetStream(input.stream);
+    inserter.SetSamplingMode(input.sampling);
     multinomial.SetEntryN(input.entryN);
-    multinomial.SetRndNum(input.rndNum);
+    multinomial.SetRndNum((input.rndNum + replicate - 1) / replicate * replicate);
+    multinomial.SetFirstSample(input.first_sample);
+    multinomial.SetPrecisionTarget(input.precision);
+    multinomial.SetConditioned(input.is_conditioned);
     inserter.Init();
     multinomial.Loop_on(distribution, inserter);
+    inserter.SetSampleWeight(multinomial.GetSampleWeight());
+    const auto aggregated = Aggregate(distribution);
     auto result = Parallel_run_output{};
-    result.histogram = inserter.GetHist();
     result.stat = inserter.GetResult();
-    result.pre_prob = distribution[0];
-    result.mid_prob = distribution[1];
-    result.post_prob = distribution[2];
+    result.pre_prob = aggregated[0];
+    result.mid_prob = aggregated[1];
+    result.post_prob = aggregated[2];
     result.entryN = multinomial.GetEntryN();
+    result.sampleN = multinomial.GetSampleNum();
+    result.filledN = static_cast<unsigned int>(inserter.GetStat().GetCount());
+    return result;
+}
 
-    {
-        auto lock = std::scoped_lock{ mu_recorder_ };
-        writer(result);
-    }
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::Single_run(const Distribution& distribution,
+                                     MultiNomial<BinSize>& multinomial,
+                                     auto& inserter,
+                                     const Parallel_run_input& input) const
+{
+    auto result = Sample(distribution, multinomial, inserter, input);
+    Telemetry::Add(Counter::points, 1);
+    auto timer = PhaseTimer{ Phase::record };
+    Record(input, std::move(result), inserter.ReleaseHist());
     inserter.Reset();
 }
 
-void FineTimeMC::Parallel_run_all_cycles(Parallel_run_input input,
-                                         const std::array<double, 3>& distribution,
-                                         auto& inserter,
-                                         auto& writer) const
+template <std::size_t BinSize>
+auto FineTimeMC<BinSize>::Register_writer(auto& writer) -> std::size_t
 {
-    auto multinomial = MultiNomial(inserter.GetEngine());
-    for (unsigned int sample_size{ input.entryN }; sample_size < input.entryN + input.entryNloopSize; ++sample_size)
+    auto lock = std::scoped_lock{ mu_writers_ };
+    auto slot = std::ranges::find(writers_, nullptr, &Writer_slot::writer);
+    if (slot == writers_.end())
     {
-        input.entryN = sample_size;
-        Single_run(distribution, multinomial, inserter, writer, input);
+        writers_.emplace_back();
+        slot = std::prev(writers_.end());
     }
+    slot->writer = &writer;
+    slot->strategy = [&writer](Parallel_run_output& result) { writer(result); };
+    return static_cast<std::size_t>(slot - writers_.begin());
+}
+
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::AddObserver(auto& observer)
+{
+    observers_.push_back(&observer);
+    observer_strategies_.emplace_back([&observer](Parallel_run_output& result) { observer(result); });
 }
 
-void FineTimeMC::Parallel_run_pre(Parallel_run_input input, double mid_prob, auto& inserter, auto& writer) const
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::RunFixedPbAllPa(double midProb, double min, double max, unsigned int num, auto& writer)
 {
-    auto distribution = std::array<double, 3>{ 0., mid_prob, 0. };
-    auto multinomial = MultiNomial(inserter.GetEngine());
-    for (int pre_index = 0; pre_index < input.pa_num; ++pre_index)
+    const double step = (max - min) / num;
+    auto input = default_epoch_input_;
+    input.writer_index = Register_writer(writer);
+
+    auto tasks = std::vector<TaskPool::Task>{};
+    tasks.reserve(num);
+    for (unsigned int index{}; index < num; ++index)
     {
-        auto pre_value = pre_index * input.pa_step + input.pa_begin;
-        distribution.front() = pre_value;
-        distribution.back() = 1 - distribution[0] - distribution[1];
-        Single_run(distribution, multinomial, inserter, writer, input);
+        input.stream = StreamKey(StreamTag::pa, index);
+        auto aggregated = std::array<double, 3>{ index * step + min, midProb, 0. };
+        aggregated.back() = 1 - aggregated[0] - aggregated[1];
+        const auto distribution = Expand<BinSize>(aggregated);
+        input.task = tasks.size();
+        tasks.emplace_back(
+            [input, distribution, this](unsigned int worker) mutable
+            {
+                input.worker = worker;
+                Run_sweep_point(input, distribution);
+            });
     }
+    Schedule(std::move(tasks), input.writer_index);
 }
 
-void FineTimeMC::RunFixedPbAllPa(double midProb, double min, double max, unsigned int num, auto& writer)
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::RunFixedPbAllEntryN(double midProb, int min, int max, auto& writer)
 {
-    auto threads = Divide_into(num, threads_num_);
-    const double step = (max - min) / num;
-    writers_.push_back(&writer);
+    auto distribution = Distribution{};
+    dis_generator_(distribution, midProb);
+    auto input = default_epoch_input_;
+    input.writer_index = Register_writer(writer);
 
-    for (const auto& size : threads)
+    auto tasks = std::vector<TaskPool::Task>{};
+    if (engine_mode_ == EngineMode::incremental)
     {
-        auto inputPar = default_epoch_input_;
-        inputPar.pa_begin = min;
-        min += step * size;
-        inputPar.pa_num = size;
-        inputPar.pa_step = step;
-
-        auto future = std::async(std::launch::async,
-                                 [inputPar, &writer, this, midProb]()
-                                 {
-                                     std::string histname = fmt::format("pa_hist_{}", threads_count_++);
-                                     auto inserter = UniformInserter{ inputPar.entryN, histname };
-                                     Parallel_run_pre(inputPar, midProb, inserter, writer);
-                                 });
-        all_thread_results_.emplace_back(std::move(future));
+        if (input.precision.relative_error > 0.)
+        {
+            throw std::logic_error("the incremental engine samples every entryN rndNum times, a precision target "
+                                   "is not supported!");
+        }
+        if (input.is_conditioned)
+        {
+            throw std::logic_error("the incremental engine adds trials to unconditioned draws, conditioned sampling "
+                                   "is not supported!");
+        }
+        for (auto first = static_cast<unsigned int>(min); first < static_cast<unsigned int>(max);
+             first += INCREMENTAL_BLOCK)
+        {
+            input.entryN = first;
+            input.stream = StreamKey(StreamTag::entryN, first);
+            const auto sizes_num = std::min(INCREMENTAL_BLOCK, static_cast<unsigned int>(max) - first);
+            input.task = tasks.size();
+            tasks.emplace_back(
+                [input, distribution, sizes_num, this](unsigned int worker) mutable
+                {
+                    input.worker = worker;
+                    Run_incremental_block(input, distribution, sizes_num);
+                });
+        }
+        Schedule(std::move(tasks), input.writer_index);
+        return;
     }
+    tasks.reserve(max - min);
+    for (auto sample_size = static_cast<unsigned int>(min); sample_size < static_cast<unsigned int>(max); ++sample_size)
+    {
+        input.entryN = sample_size;
+        input.stream = StreamKey(StreamTag::entryN, sample_size);
+        input.task = tasks.size();
+        tasks.emplace_back(
+            [input, distribution, this](unsigned int worker) mutable
+            {
+                input.worker = worker;
+                Run_sweep_point(input, distribution);
+            });
+    }
+    Schedule(std::move(tasks), input.writer_index);
 }
 
-void FineTimeMC::RunFixedPbAllEntryN(double midProb, int min, int max, auto& writer)
+// The samples are split into shards of about SHARD_SAMPLES, a number independent of the threads, so the merged
+// histogram is the same for any number of threads. A precision target needs the whole point and keeps it in one task.
+// Only this single point is split, the sweeps keep every point in one task and spread their many points instead.
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::RunWithAllFixed(std::array<double, 3> aggregated, auto& writer)
 {
+    if (shard_count_ > 1)
+    {
+        throw std::logic_error("the fixed point cannot be split over shards!");
+    }
+    auto input = default_epoch_input_;
+    input.stream = StreamKey(StreamTag::fix, 0);
+    input.writer_index = Register_writer(writer);
+    const auto distribution = Expand<BinSize>(aggregated);
+    // SetRndNumber rejects 0, so there is at least one shard with one batch
+    const auto shards_num =
+        (input.precision.relative_error > 0.) ? 1U : (input.rndNum + SHARD_SAMPLES - 1) / SHARD_SAMPLES;
+    // whole batches per shard, so that no replicate of the sampling modes is split
+    constexpr auto batch_size = static_cast<unsigned int>(SAMPLE_BATCH_SIZE);
+    const auto batches_num = (input.rndNum + batch_size - 1) / batch_size;
+    auto shard_sizes = Divide_into(batches_num, shards_num);
+    for (auto& size : shard_sizes)
+    {
+        size *= batch_size;
+    }
+    shard_sizes.back() -= std::min(shard_sizes.back(), batches_num * batch_size - input.rndNum);
+    auto shards = std::make_shared<Point_shards>(shard_sizes.size());
 
-    auto threads = Divide_into(max - min, threads_num_);
-    std::array<double, 3> distribution = {};
-    dis_generator_(distribution, midProb);
-    writers_.push_back(&writer);
-
-    int init{ min };
-    auto sample_size_starts = ranges::transform_view(threads,
-                                                     [&init](const auto& ele)
-                                                     {
-                                                         auto old = init;
-                                                         init += ele;
-                                                         return old;
-                                                     });
-    for (const auto& [start, num] : ranges::views::zip(sample_size_starts, threads))
+    auto tasks = std::vector<TaskPool::Task>{};
+    tasks.reserve(shard_sizes.size());
+    for (std::size_t index{}; index < shard_sizes.size(); ++index)
     {
-        auto input = default_epoch_input_;
-        input.entryN = start;
-        input.entryNloopSize = num;
-        auto future = std::async(std::launch::async,
-                                 [input, this, &writer, distribution]()
-                                 {
-                                     std::string histname = fmt::format("entryN_hist_{}", threads_count_++);
-                                     auto inserter = UniformInserter{ input.entryN + input.entryNloopSize, histname };
-                                     Parallel_run_all_cycles(input, distribution, inserter, writer);
-                                 });
-        all_thread_results_.emplace_back(std::move(future));
+        input.rndNum = shard_sizes[index];
+        input.task = tasks.size();
+        tasks.emplace_back(
+            [input, distribution, shards, index, this](unsigned int worker) mutable
+            {
+                input.worker = worker;
+                Run_shard(input, distribution, *shards, index);
+            });
+        input.first_sample += shard_sizes[index];
     }
+    Schedule(std::move(tasks), input.writer_index);
 }
 
-void FineTimeMC::RunWithAllFixed(std::array<double, 3> distribution, auto& writer)
+template <std::size_t BinSize>
+void FineTimeMC<BinSize>::RunGrid(const Grid_axis& pa_axis,
+                                  const Grid_axis& pb_axis,
+                                  const Grid_axis& entryN_axis,
+                                  auto& writer)
 {
     auto input = default_epoch_input_;
-    writers_.push_back(&writer);
-    auto future = std::async(std::launch::async,
-                             [input, this, distribution, &writer]()
-                             {
-                                 auto inserter = UniformInserter{ entryN_, "fix distribution" };
-                                 auto multinomial = MultiNomial(inserter.GetEngine());
-                                 Single_run(distribution, multinomial, inserter, writer, input);
-                             });
-    all_thread_results_.emplace_back(std::move(future));
+    input.writer_index = Register_writer(writer);
+
+    auto tasks = std::vector<TaskPool::Task>{};
+    tasks.reserve(static_cast<std::size_t>(pa_axis.num) * pb_axis.num * entryN_axis.num);
+    for (unsigned int pa_index{}; pa_index < pa_axis.num; ++pa_index)
+    {
+        for (unsigned int pb_index{}; pb_index < pb_axis.num; ++pb_index)
+        {
+            auto aggregated = std::array<double, 3>{ pa_axis.GetValue(pa_index), pb_axis.GetValue(pb_index), 0. };
+            aggregated.back() = 1 - aggregated[0] - aggregated[1];
+            // round-off of the axis values must not drop points on the edge pa + pb = 1
+            constexpr double edge_tolerance = 1e-12;
+            if (aggregated.back() < -edge_tolerance)
+            {
+                continue;
+            }
+            aggregated.back() = std::max(aggregated.back(), 0.);
+            const auto distribution = Expand<BinSize>(aggregated);
+            for (unsigned int entryN_index{}; entryN_index < entryN_axis.num; ++entryN_index)
+            {
+                // an axis with steps below 1 rounds several values to the same entryN, which is run once
+                input.entryN = entryN_axis.GetRoundedValue(entryN_index);
+                if (entryN_index > 0 && input.entryN == entryN_axis.GetRoundedValue(entryN_index - 1))
+                {
+                    continue;
+                }
+                const auto point_index =
+                    (static_cast<uint64_t>(pa_index) * pb_axis.num + pb_index) * entryN_axis.num + entryN_index;
+                input.stream = StreamKey(StreamTag::grid, point_index);
+                input.task = tasks.size();
+                tasks.emplace_back(
+                    [input, distribution, this](unsigned int worker) mutable
+                    {
+                        input.worker = worker;
+                        Run_sweep_point(input, distribution);
+                    });
+            }
+        }
+    }
+    Schedule(std::move(tasks), input.writer_index);
 }
+
+extern template class FineTimeMC<3>;
+extern template class FineTimeMC<5>;
+extern template class FineTimeMC<7>;
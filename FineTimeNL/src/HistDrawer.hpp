@@ -0,0 +1,81 @@
+#pragma once
+
+#include "LineDrawer.hpp"
+#include "Sinker.hpp"
+#include <TCanvas.h>
+#include <TH1D.h>
+#include <cmath>
+
+// ROOT drawing of the fix mode histogram, part of the optional finetime_root target. Nothing in the finetime core
+// includes this file.
+
+// The only place the native histogram meets ROOT. Double bins keep the 64 bit counts exact up to 2^53, and the
+// statistics are taken from the exact moments instead of the bin centres.
+inline auto ToTH1(const Histogram& histogram, std::string_view name) -> std::unique_ptr<TH1>
+{
+    TH1::AddDirectory(false);
+    auto th1 = std::make_unique<TH1D>(name.data(),
+                                      name.data(),
+                                      static_cast<int>(histogram.GetBinsNum()),
+                                      histogram.GetLow(),
+                                      histogram.GetHigh());
+    const auto weight = histogram.GetWeight();
+    if (weight != 1.)
+    {
+        th1->Sumw2();
+    }
+    const auto counts = histogram.GetCounts();
+    for (std::size_t bin{}; bin < counts.size(); ++bin)
+    {
+        const auto count = static_cast<double>(counts[bin]);
+        th1->SetBinContent(static_cast<int>(bin), count * weight);
+        if (weight != 1.)
+        {
+            th1->SetBinError(static_cast<int>(bin), std::sqrt(count) * weight);
+        }
+    }
+    const auto& stat = histogram.GetStat();
+    const auto entries = static_cast<double>(stat.GetCount());
+    const auto mean = stat.GetMean();
+    // sum of weights, of squared weights, of w x and of w x^2
+    auto stats = std::array<double, 4>{ entries * weight,
+                                        entries * weight * weight,
+                                        entries * weight * mean,
+                                        entries * weight * (stat.GetVariance() + mean * mean) };
+    th1->PutStats(stats.data());
+    th1->SetEntries(entries);
+    return th1;
+}
+
+// HistWriter that saves a picture of the histogram, with the boundaries of the central bin as vertical lines
+template <typename WriteStrategy>
+class HistDrawer : public HistWriter<WriteStrategy>
+{
+  public:
+    HistDrawer(std::string_view filename, WriteStrategy&& strategy)
+        : HistWriter<WriteStrategy>{ filename, std::forward<WriteStrategy>(strategy) }
+    {
+    }
+
+    void write() override
+    {
+        auto timer = PhaseTimer{ Phase::write };
+        constexpr int default_canvas_width = 1000;
+        constexpr int default_canvas_height = 800;
+        auto canvas = TCanvas{ "canvas", "canvas", default_canvas_width, default_canvas_height };
+        const auto& histogram = this->GetHistogram();
+        fmt::print("histogram total entries: {}\n", histogram.GetEntries());
+        auto th1 = ToTH1(histogram, "histogram");
+        th1->Draw();
+        canvas.Update();
+
+        auto linesDraw = LineDrawer(2);
+        const auto& [start, end] = this->GetBoundaries();
+        auto lineL = linesDraw.Draw_vLine(&canvas, start);
+        auto lineR = linesDraw.Draw_vLine(&canvas, end);
+        lineL->Draw();
+        lineR->Draw();
+
+        canvas.SaveAs(this->GetFileName().c_str());
+    }
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "RunningStat.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fmt/core.h>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Fixed binning histogram with 64 bit counts and exact running moments of the filled values. Bin 0 and bin
+// GetBinsNum() + 1 hold the underflow and the overflow, the same numbering as TH1. Shards filled by different threads
+// or sample blocks are combined with Merge in O(bins). ROOT is only involved when drawing, see ToTH1 in HistDrawer.hpp.
+class Histogram
+{
+  public:
+    Histogram() = default;
+    Histogram(std::size_t bins_num, double low, double high)
+        : low_{ low }
+        , high_{ high }
+        , scale_{ (high > low) ? static_cast<double>(bins_num) / (high - low) : 0. }
+        , counts_(bins_num + 2, 0)
+    {
+        if (bins_num == 0 || !(high > low))
+        {
+            throw std::logic_error(
+                fmt::format("invalid histogram binning: {} bins over [{}, {})", bins_num, low, high));
+        }
+    }
+
+    void Fill(double value)
+    {
+        AddCount(value);
+        stat_.Push(value);
+    }
+
+    // Fill split in two for batches: counts per value, and the moments merged once per batch
+    void AddCount(double value)
+    {
+        ++counts_[FindBin(value)];
+    }
+    void AddMoments(const RunningStat<true>& stat)
+    {
+        stat_.Merge(stat);
+    }
+
+    // Every count stands for weight draws of the sampled distribution, less than 1 for draws conditioned on a
+    // nonzero central bin. The counts and the moments stay those of the draws, GetWeightedContent scales them.
+    void SetWeight(double weight)
+    {
+        weight_ = weight;
+    }
+
+    void Merge(const Histogram& other)
+    {
+        if (other.counts_.size() != counts_.size() || other.low_ != low_ || other.high_ != high_)
+        {
+            throw std::logic_error("cannot merge histograms with different binning!");
+        }
+        if (other.weight_ != weight_)
+        {
+            throw std::logic_error("cannot merge histograms with different weights!");
+        }
+        for (std::size_t bin{}; bin < counts_.size(); ++bin)
+        {
+            counts_[bin] += other.counts_[bin];
+        }
+        stat_.Merge(other.stat_);
+    }
+
+    void Reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        stat_.Reset();
+        weight_ = 1.;
+    }
+
+    // empty histogram with a new binning, reusing the memory of the counts
+    void Rebin(std::size_t bins_num, double low, double high)
+    {
+        if (bins_num == 0 || !(high > low))
+        {
+            throw std::logic_error(
+                fmt::format("invalid histogram binning: {} bins over [{}, {})", bins_num, low, high));
+        }
+        low_ = low;
+        high_ = high;
+        scale_ = static_cast<double>(bins_num) / (high - low);
+        counts_.assign(bins_num + 2, 0);
+        stat_.Reset();
+        weight_ = 1.;
+    }
+
+    [[nodiscard]] auto FindBin(double value) const -> std::size_t
+    {
+        if (value < low_)
+        {
+            return 0;
+        }
+        const auto bin = static_cast<std::size_t>((value - low_) * scale_) + 1;
+        return std::min(bin, counts_.size() - 1);
+    }
+
+    [[nodiscard]] auto GetBinsNum() const -> std::size_t
+    {
+        return counts_.empty() ? 0 : counts_.size() - 2;
+    }
+    [[nodiscard]] auto GetLow() const -> double
+    {
+        return low_;
+    }
+    [[nodiscard]] auto GetHigh() const -> double
+    {
+        return high_;
+    }
+    [[nodiscard]] auto GetBinContent(std::size_t bin) const -> uint64_t
+    {
+        return counts_.at(bin);
+    }
+    [[nodiscard]] auto GetWeight() const -> double
+    {
+        return weight_;
+    }
+    [[nodiscard]] auto GetWeightedContent(std::size_t bin) const -> double
+    {
+        return static_cast<double>(counts_.at(bin)) * weight_;
+    }
+    // including underflow and overflow
+    [[nodiscard]] auto GetCounts() const -> std::span<const uint64_t>
+    {
+        return counts_;
+    }
+    [[nodiscard]] auto GetEntries() const -> uint64_t
+    {
+        return stat_.GetCount();
+    }
+    [[nodiscard]] auto GetStat() const -> const RunningStat<true>&
+    {
+        return stat_;
+    }
+
+  private:
+    double low_ = 0.;
+    double high_ = 1.;
+    double scale_ = 0.; // bins per unit
+    double weight_ = 1.;
+    std::vector<uint64_t> counts_;
+    RunningStat<true> stat_;
+};
@@ -0,0 +1,68 @@
+#include "HistogramPool.hpp"
+
+void HistogramRecycler::operator()(Histogram* histogram) const
+{
+    if (pool != nullptr)
+    {
+        pool->Recycle(histogram);
+        return;
+    }
+    delete histogram; // NOLINT
+}
+
+auto HistogramPool::Create() -> std::shared_ptr<HistogramPool>
+{
+    auto pool = std::shared_ptr<HistogramPool>(new HistogramPool{}); // NOLINT
+    pool->self_ = pool;
+    return pool;
+}
+
+auto HistogramPool::Acquire(std::size_t bins_num, double low, double high) -> HistogramHandle
+{
+    auto histogram = std::unique_ptr<Histogram>{};
+    {
+        auto lock = std::scoped_lock{ mu_free_ };
+        if (!free_.empty())
+        {
+            histogram = std::move(free_.back());
+            free_.pop_back();
+        }
+        else
+        {
+            ++created_num_;
+        }
+    }
+    if (histogram == nullptr)
+    {
+        histogram = std::make_unique<Histogram>(bins_num, low, high);
+    }
+    else
+    {
+        histogram->Rebin(bins_num, low, high);
+    }
+    return HistogramHandle{ histogram.release(), HistogramRecycler{ self_.lock() } };
+}
+
+auto HistogramPool::GetFreeNum() const -> std::size_t
+{
+    auto lock = std::scoped_lock{ mu_free_ };
+    return free_.size();
+}
+
+auto HistogramPool::GetCreatedNum() const -> std::size_t
+{
+    auto lock = std::scoped_lock{ mu_free_ };
+    return created_num_;
+}
+
+void HistogramPool::Recycle(Histogram* histogram)
+{
+    auto owned = std::unique_ptr<Histogram>{ histogram };
+    auto lock = std::scoped_lock{ mu_free_ };
+    free_.push_back(std::move(owned));
+}
+
+auto Make_histogram(std::size_t bins_num, double low, double high) -> HistogramHandle
+{
+    return HistogramHandle{ new Histogram(bins_num, low, high), HistogramRecycler{} }; // NOLINT
+}
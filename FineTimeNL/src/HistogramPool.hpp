@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Histogram.hpp"
+#include "traits.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Recycles the histograms of finished points. A released HistogramHandle puts its histogram back, and Acquire hands
+// it out again rebinned and empty, so a sweep allocates only as many histograms as are alive at the same time. A
+// histogram held by a sink is not recycled, which is why HistCollector releases every one once it is written.
+// Handles keep their pool alive.
+class HistogramPool
+{
+  public:
+    static auto Create() -> std::shared_ptr<HistogramPool>;
+
+    auto Acquire(std::size_t bins_num, double low, double high) -> HistogramHandle;
+
+    [[nodiscard]] auto GetFreeNum() const -> std::size_t;
+    [[nodiscard]] auto GetCreatedNum() const -> std::size_t;
+
+  private:
+    friend struct HistogramRecycler;
+
+    std::weak_ptr<HistogramPool> self_;
+    mutable std::mutex mu_free_;
+    std::vector<std::unique_ptr<Histogram>> free_;
+    std::size_t created_num_ = 0;
+
+    HistogramPool() = default;
+    void Recycle(Histogram* histogram);
+};
+
+// a histogram without pool, deleted when the handle is released
+auto Make_histogram(std::size_t bins_num, double low, double high) -> HistogramHandle;
@@ -1,6 +1,7 @@
 #pragma once
 #include <TCanvas.h>
 #include <TLine.h>
+#include <memory>
 
 class LineDrawer
 {
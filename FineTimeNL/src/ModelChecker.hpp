@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ErrorModels.hpp"
+#include "Sinker.hpp"
+#include <cmath>
+#include <limits>
+
+// Compares the Monte Carlo stderr of every point with analytic error models as the results arrive. The uncertainty
+// of a stderr is taken from the Gaussian approximation stderr / sqrt(2 (filledN - 1)), results of the exact engine
+// have none and only get residuals. write() fits the free parameters of the models if enabled, prints chi2 / ndf of
+// every model and writes the table of the points with the value, residual and pull of each model.
+template <typename WriteStrategy>
+class ModelChecker : public Sinker
+{
+  public:
+    ModelChecker(std::string_view filename, WriteStrategy&& strategy, std::vector<Error_model> models)
+        : filename_{ filename }
+        , write_strategy_{ std::forward<WriteStrategy>(strategy) }
+    {
+        for (auto& model : models)
+        {
+            AddModel(std::move(model));
+        }
+    }
+
+    // a model added later is evaluated at the points already collected
+    void AddModel(Error_model model)
+    {
+        auto& values = model_values_.emplace_back(data_.points.size());
+        model.evaluate(data_.points, model.parameters, values);
+        models_.push_back(std::move(model));
+    }
+
+    void SetFitting(bool is_fitting)
+    {
+        is_fitting_ = is_fitting;
+    }
+
+    void operator()(auto& result)
+    {
+        write_strategy_(this, result);
+    }
+
+    void Add(const Parallel_run_output& result)
+    {
+        const auto point =
+            Model_point{ .pa = result.pre_prob, .pb = result.mid_prob, .entryN = static_cast<double>(result.entryN) };
+        data_.points.push_back(point);
+        data_.values.push_back(result.stat.err);
+        data_.sigmas.push_back((result.filledN > 1) ? result.stat.err / std::sqrt(2. * (result.filledN - 1)) : 0.);
+        auto value = 0.;
+        for (std::size_t model{}; model < models_.size(); ++model)
+        {
+            models_[model].evaluate({ &point, 1 }, models_[model].parameters, { &value, 1 });
+            model_values_[model].push_back(value);
+        }
+    }
+
+    // fits the models and evaluates them at the final parameters
+    void Evaluate()
+    {
+        summaries_.clear();
+        for (std::size_t model{}; model < models_.size(); ++model)
+        {
+            const auto& summary = summaries_.emplace_back(Fit_model(models_[model], data_, is_fitting_));
+            if (!summary.parameters.empty())
+            {
+                models_[model].evaluate(data_.points, summary.parameters, model_values_[model]);
+            }
+        }
+    }
+
+    [[nodiscard]] auto GetSummaries() const -> const std::vector<Model_summary>&
+    {
+        return summaries_;
+    }
+
+    void write() override
+    {
+        auto timer = PhaseTimer{ Phase::write };
+        Evaluate();
+        for (const auto& summary : summaries_)
+        {
+            fmt::print("model {}: chi2 / ndf = {:.6g} / {}", summary.name, summary.chi2, summary.ndf);
+            for (std::size_t par{}; par < summary.parameters.size(); ++par)
+            {
+                fmt::print(", p{} = {:.6g} +- {:.3g}", par, summary.parameters[par], summary.parameter_errors[par]);
+            }
+            fmt::print("\n");
+        }
+
+        std::cout << "writing to file " << filename_ << "\n";
+        auto ostream = std::ofstream{ filename_, std::ios_base::out | std::ios_base::trunc };
+        ostream << "pa, pb, entryN, stderr, sigma";
+        for (const auto& model : models_)
+        {
+            ostream << fmt::format(", {0}, {0}_residual, {0}_pull", model.name);
+        }
+        ostream << "\n";
+        for (std::size_t index{}; index < data_.points.size(); ++index)
+        {
+            const auto& point = data_.points[index];
+            const auto value = data_.values[index];
+            const auto sigma = data_.sigmas[index];
+            ostream << fmt::format("{}, {}, {}, {}, {}", point.pa, point.pb, point.entryN, value, sigma);
+            for (const auto& values : model_values_)
+            {
+                const auto residual = value - values[index];
+                const auto pull = (sigma > 0.) ? residual / sigma : std::numeric_limits<double>::quiet_NaN();
+                ostream << fmt::format(", {}, {}, {}", values[index], residual, pull);
+            }
+            ostream << "\n";
+        }
+        std::cout << "writing to file " << filename_ << " finished\n";
+    }
+
+  private:
+    std::string filename_;
+    bool is_fitting_ = false;
+    std::vector<Error_model> models_;
+    std::vector<std::vector<double>> model_values_; // per model, one value per point
+    Model_data data_;
+    std::vector<Model_summary> summaries_;
+    std::remove_const_t<WriteStrategy> write_strategy_;
+};
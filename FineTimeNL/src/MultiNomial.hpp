@@ -1,16 +1,19 @@
 #pragma once
 
+#include "BinomialSampler.hpp"
+#include "CounterRNG.hpp"
+#include "SampleKernels.hpp"
+#include "Telemetry.hpp"
 #include "traits.hpp"
-#include <Math/GSLRndmEngines.h>
-#include <TH1I.h>
 #include <fmt/core.h>
 
 extern const unsigned int SEED_NUM;
 
+template <std::size_t BinSize = 3>
 class MultiNomial
 {
   public:
-    explicit MultiNomial(ROOT::Math::GSLRandomEngine* engine)
+    explicit MultiNomial(CounterEngine* engine)
         : engine_{ engine }
     {
     }
@@ -28,29 +31,159 @@ class MultiNomial
         return entryN_;
     }
 
-    void SetHist(auto&&... args)
-    {
-        th1 = TH1I{ std::forward<decltype(args)>(args)... };
-    }
-
     [[nodiscard]] auto RandomFill(const auto& distribution) const
     {
         auto vec = std::vector<double>(distribution.begin(), distribution.end());
         return engine_->Multinomial(entryN_, vec);
     }
 
-    auto Loop_on(const auto& distribution, std::invocable<decltype(distribution)> auto&& opt) const
+    // draw with the sampler prepared by SetDistribution
+    void RandomFill(std::array<unsigned int, BinSize>& entries)
+    {
+        sampler_(*engine_, entries);
+    }
+
+    void SetDistribution(const std::array<double, BinSize>& distribution)
+    {
+        sampler_.Set(entryN_, distribution);
+    }
+
+    // samples are numbered from first on, so the shards of one point draw disjoint ranges of its stream
+    void SetFirstSample(uint64_t first)
+    {
+        first_sample_ = first;
+    }
+
+    // draws of the BinSize distributions conditioned on a nonzero central bin, see
+    // CentralMultinomialSampler::SetConditioned
+    void SetConditioned(bool is_conditioned)
     {
-        for (size_t i{}; i < rndNum_; ++i)
+        sampler_.SetConditioned(is_conditioned);
+    }
+
+    // importance weight of the draws of the distribution set last
+    [[nodiscard]] auto GetSampleWeight() const -> double
+    {
+        return sampler_.GetWeight();
+    }
+
+    void SetPrecisionTarget(const Precision_target& target)
+    {
+        precision_ = target;
+    }
+
+    // samples drawn by the last Loop_on, less than the set number if the precision target was reached
+    [[nodiscard]] auto GetSampleNum() const -> unsigned int
+    {
+        return sampleN_;
+    }
+
+    // Runs in blocks when a precision target is set and stops after the first block that reaches it. Blocks are
+    // multiples of the batch size, so a stopped loop gives the same result as a fixed one with that many samples.
+    auto Loop_on(const auto& distribution, std::invocable<decltype(distribution)> auto&& opt)
+    {
+        if constexpr (std::is_same_v<std::remove_cvref_t<decltype(distribution)>, std::array<double, BinSize>>)
+        {
+            SetDistribution(distribution);
+        }
+        const auto is_adaptive = precision_.relative_error > 0.;
+        const auto block_size = is_adaptive ? (std::max(precision_.block_size, 1U) + SAMPLE_BATCH_SIZE - 1) /
+                                                  SAMPLE_BATCH_SIZE * SAMPLE_BATCH_SIZE
+                                            : rndNum_;
+        sampleN_ = 0;
+        while (sampleN_ < rndNum_)
         {
-            auto entries = RandomFill(distribution);
-            opt(entries);
+            const auto end = static_cast<unsigned int>(std::min<std::size_t>(rndNum_, sampleN_ + block_size));
+            Loop_on_range(distribution, opt, first_sample_ + sampleN_, first_sample_ + end);
+            sampleN_ = end;
+            if (is_adaptive && sampleN_ >= precision_.min_blocks * block_size && IsPrecisionReached(opt))
+            {
+                break;
+            }
         }
+        Telemetry::Add(Counter::samples, sampleN_);
     }
 
   private:
     unsigned int entryN_ = 0;
     unsigned int rndNum_ = 0;
-    ROOT::Math::GSLRandomEngine* engine_ = nullptr;
-    TH1I th1 = TH1I{};
+    unsigned int sampleN_ = 0;
+    uint64_t first_sample_ = 0;
+    CounterEngine* engine_ = nullptr;
+    CentralMultinomialSampler<BinSize> sampler_;
+    Precision_target precision_;
+
+    void Loop_on_range(const auto& distribution, auto& opt, std::size_t begin, std::size_t end)
+    {
+        if constexpr (std::is_same_v<std::remove_cvref_t<decltype(distribution)>, std::array<double, BinSize>>)
+        {
+            if constexpr (requires { opt.Insert_batch(std::declval<const SampleBatch&>()); })
+            {
+                Loop_on_batches(opt, begin, end);
+                return;
+            }
+            // draws and insertions are not timed apart here, it would cost two clock reads per sample
+            auto timer = PhaseTimer{ Phase::draw };
+            auto entries = std::array<unsigned int, BinSize>{};
+            for (auto i = begin; i < end; ++i)
+            {
+                engine_->SetSample(i);
+                RandomFill(entries);
+                opt(entries);
+            }
+        }
+        else
+        {
+            auto timer = PhaseTimer{ Phase::draw };
+            for (auto i = begin; i < end; ++i)
+            {
+                engine_->SetSample(i);
+                auto entries = RandomFill(distribution);
+                opt(entries);
+            }
+        }
+    }
+
+    // relative standard errors of the mean and of the standard deviation, as estimated by the inserter
+    [[nodiscard]] auto IsPrecisionReached(const auto& opt) const -> bool
+    {
+        if constexpr (requires { opt.GetStdDevRelError(); })
+        {
+            return opt.GetMeanRelError() <= precision_.relative_error &&
+                   opt.GetStdDevRelError() <= precision_.relative_error;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    void Loop_on_batches(auto& opt, std::size_t begin, std::size_t end)
+    {
+        auto batch = SampleBatch{};
+        auto entries = std::array<unsigned int, BinSize>{};
+        auto blocks = BatchArray<Philox4x32::Counter>{};
+        for (auto first = begin; first < end; first += SAMPLE_BATCH_SIZE)
+        {
+            batch.first_sample = first;
+            batch.size = std::min(SAMPLE_BATCH_SIZE, end - first);
+            {
+                auto timer = PhaseTimer{ Phase::draw };
+                // the first random block of every draw is computed for all lanes at once
+                FillDrawBlocks(engine_->GetKey(), engine_->GetStream(), first, blocks);
+                for (size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+                {
+                    entries = {};
+                    if (lane < batch.size)
+                    {
+                        engine_->SetSample(first + lane, blocks[lane]);
+                        RandomFill(entries);
+                    }
+                    SetBatchCounts(batch, lane, entries);
+                }
+            }
+            auto timer = PhaseTimer{ Phase::insert };
+            opt.Insert_batch(batch);
+        }
+    }
 };
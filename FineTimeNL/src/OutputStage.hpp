@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Telemetry.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Bounded queue with a single consumer thread. Any number of producers hand items over with Push, which blocks
+// while capacity items are waiting (backpressure). The consumer processes them in queue order. An exception thrown
+// by the consumer is rethrown by the next Drain, the items pushed until then are discarded.
+template <typename Item>
+class OutputStage
+{
+  public:
+    using Consumer = std::function<void(Item&)>;
+
+    OutputStage(Consumer consumer, std::size_t capacity)
+        : capacity_{ (capacity == 0) ? 1 : capacity }
+        , consumer_{ std::move(consumer) }
+        , thread_{ [this]() { Consume(); } }
+    {
+    }
+
+    ~OutputStage()
+    {
+        {
+            auto lock = std::scoped_lock{ mu_items_ };
+            is_stopping_ = true;
+        }
+        cv_items_.notify_all();
+        thread_.join();
+    }
+
+    OutputStage(const OutputStage&) = delete;
+    OutputStage(OutputStage&&) = delete;
+    auto operator=(const OutputStage&) -> OutputStage& = delete;
+    auto operator=(OutputStage&&) -> OutputStage& = delete;
+
+    void Push(Item item)
+    {
+        auto lock = std::unique_lock{ mu_items_ };
+        if (items_.size() >= capacity_)
+        {
+            auto timer = PhaseTimer{ Phase::lock_wait };
+            cv_space_.wait(lock, [this]() { return items_.size() < capacity_; });
+        }
+        items_.emplace_back(std::move(item));
+        cv_items_.notify_one();
+    }
+
+    // blocks until every pushed item has been processed
+    void Drain()
+    {
+        auto lock = std::unique_lock{ mu_items_ };
+        cv_space_.wait(lock, [this]() { return items_.empty() && !is_busy_; });
+        if (exception_ != nullptr)
+        {
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+        }
+    }
+
+  private:
+    std::size_t capacity_ = 1;
+    std::deque<Item> items_;
+    bool is_busy_ = false;
+    bool is_stopping_ = false;
+    std::exception_ptr exception_;
+    std::mutex mu_items_;
+    std::condition_variable cv_items_;
+    std::condition_variable cv_space_;
+    Consumer consumer_;
+    std::thread thread_;
+
+    void Consume()
+    {
+        Telemetry::SetThreadName("output");
+        auto lock = std::unique_lock{ mu_items_ };
+        while (true)
+        {
+            cv_items_.wait(lock, [this]() { return !items_.empty() || is_stopping_; });
+            if (items_.empty())
+            {
+                return;
+            }
+            auto item = std::move(items_.front());
+            items_.pop_front();
+            cv_space_.notify_all();
+            if (exception_ != nullptr)
+            {
+                continue;
+            }
+            is_busy_ = true;
+            lock.unlock();
+
+            auto exception = std::exception_ptr{};
+            try
+            {
+                consumer_(item);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            is_busy_ = false;
+            exception_ = exception;
+            cv_space_.notify_all();
+        }
+    }
+};
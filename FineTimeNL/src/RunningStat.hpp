@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+struct CentralMoments
+{
+    uint64_t count = 0;
+    double mean = 0.;
+    double m2 = 0.;
+    double m3 = 0.;
+    double m4 = 0.;
+};
+
+// Exact streaming moments (Welford, with Pebay's updates for the 3rd and 4th central moments).
+// Partial states from different threads or sample blocks can be combined with Merge().
+template <bool HigherMoments = false>
+class RunningStat
+{
+  public:
+    RunningStat() = default;
+    explicit RunningStat(const CentralMoments& moments)
+        : count_{ moments.count }
+        , mean_{ moments.mean }
+        , m2_{ moments.m2 }
+        , m3_{ moments.m3 }
+        , m4_{ moments.m4 }
+    {
+    }
+
+    void Push(double value)
+    {
+        const auto prev_count = static_cast<double>(count_);
+        ++count_;
+        const auto count = static_cast<double>(count_);
+        const auto delta = value - mean_;
+        const auto delta_n = delta / count;
+        const auto term = delta * delta_n * prev_count;
+        mean_ += delta_n;
+        if constexpr (HigherMoments)
+        {
+            const auto delta_n2 = delta_n * delta_n;
+            m4_ += term * delta_n2 * (count * count - 3 * count + 3) + 6 * delta_n2 * m2_ - 4 * delta_n * m3_;
+            m3_ += term * delta_n * (count - 2) - 3 * delta_n * m2_;
+        }
+        m2_ += term;
+    }
+
+    void Merge(const RunningStat& other)
+    {
+        if (other.count_ == 0)
+        {
+            return;
+        }
+        if (count_ == 0)
+        {
+            *this = other;
+            return;
+        }
+        const auto count_a = static_cast<double>(count_);
+        const auto count_b = static_cast<double>(other.count_);
+        const auto count = count_a + count_b;
+        const auto delta = other.mean_ - mean_;
+        const auto delta2 = delta * delta;
+        if constexpr (HigherMoments)
+        {
+            const auto delta3 = delta2 * delta;
+            const auto delta4 = delta2 * delta2;
+            m4_ += other.m4_ +
+                   delta4 * count_a * count_b * (count_a * count_a - count_a * count_b + count_b * count_b) /
+                       (count * count * count) +
+                   6 * delta2 * (count_a * count_a * other.m2_ + count_b * count_b * m2_) / (count * count) +
+                   4 * delta * (count_a * other.m3_ - count_b * m3_) / count;
+            m3_ += other.m3_ + delta3 * count_a * count_b * (count_a - count_b) / (count * count) +
+                   3 * delta * (count_a * other.m2_ - count_b * m2_) / count;
+        }
+        m2_ += other.m2_ + delta2 * count_a * count_b / count;
+        mean_ += delta * count_b / count;
+        count_ += other.count_;
+    }
+
+    void Reset()
+    {
+        *this = RunningStat{};
+    }
+
+    [[nodiscard]] auto GetCount() const -> uint64_t
+    {
+        return count_;
+    }
+
+    [[nodiscard]] auto GetMean() const -> double
+    {
+        return mean_;
+    }
+
+    // population variance, same convention as TH1::GetStdDev
+    [[nodiscard]] auto GetVariance() const -> double
+    {
+        return (count_ == 0) ? 0. : m2_ / static_cast<double>(count_);
+    }
+
+    [[nodiscard]] auto GetStdDev() const -> double
+    {
+        return std::sqrt(GetVariance());
+    }
+
+    [[nodiscard]] auto GetSkewness() const -> double
+        requires HigherMoments
+    {
+        return (m2_ == 0.) ? 0. : std::sqrt(static_cast<double>(count_)) * m3_ / std::pow(m2_, 1.5);
+    }
+
+    [[nodiscard]] auto GetKurtosis() const -> double
+        requires HigherMoments
+    {
+        return (m2_ == 0.) ? 0. : static_cast<double>(count_) * m4_ / (m2_ * m2_);
+    }
+
+    // standard error of the mean relative to the mean
+    [[nodiscard]] auto GetMeanRelError() const -> double
+    {
+        if (count_ == 0 || mean_ == 0.)
+        {
+            return INFINITY;
+        }
+        return GetStdDev() / (std::sqrt(static_cast<double>(count_)) * std::abs(mean_));
+    }
+
+    // large sample standard error of the standard deviation relative to it, sqrt((kurtosis - 1) / (4 n))
+    [[nodiscard]] auto GetStdDevRelError() const -> double
+        requires HigherMoments
+    {
+        if (count_ < 2 || m2_ == 0.)
+        {
+            return INFINITY;
+        }
+        return std::sqrt(std::max(GetKurtosis() - 1., 0.) / (4. * static_cast<double>(count_)));
+    }
+
+  private:
+    uint64_t count_ = 0;
+    double mean_ = 0.;
+    double m2_ = 0.;
+    double m3_ = 0.;
+    double m4_ = 0.;
+};
+
+// Errors of mean and standard deviation for samples that are only independent between replicates, i.e. blocks of
+// samples placed together by a variance reduced SamplingMode. Every replicate contributes its number of values, their
+// sum and their sum of squares, whose mean vector and covariance are tracked with Welford's update. Mean and variance
+// are ratio estimators over all replicates and their errors follow from linearising them in these sums.
+class ReplicateStat
+{
+  public:
+    void Push(double count, double sum, double sum2)
+    {
+        const auto replicate = std::array<double, 3>{ count, sum, sum2 };
+        ++replicates_;
+        auto delta = std::array<double, 3>{};
+        for (std::size_t index{}; index < 3; ++index)
+        {
+            delta[index] = replicate[index] - mean_[index];
+            mean_[index] += delta[index] / static_cast<double>(replicates_);
+        }
+        for (std::size_t row{}; row < 3; ++row)
+        {
+            for (std::size_t column{}; column < 3; ++column)
+            {
+                comoment_[row][column] += delta[row] * (replicate[column] - mean_[column]);
+            }
+        }
+    }
+
+    void Merge(const ReplicateStat& other)
+    {
+        if (other.replicates_ == 0)
+        {
+            return;
+        }
+        if (replicates_ == 0)
+        {
+            *this = other;
+            return;
+        }
+        const auto count_a = static_cast<double>(replicates_);
+        const auto count_b = static_cast<double>(other.replicates_);
+        const auto count = count_a + count_b;
+        auto delta = std::array<double, 3>{};
+        for (std::size_t index{}; index < 3; ++index)
+        {
+            delta[index] = other.mean_[index] - mean_[index];
+            mean_[index] += delta[index] * count_b / count;
+        }
+        for (std::size_t row{}; row < 3; ++row)
+        {
+            for (std::size_t column{}; column < 3; ++column)
+            {
+                comoment_[row][column] +=
+                    other.comoment_[row][column] + delta[row] * delta[column] * count_a * count_b / count;
+            }
+        }
+        replicates_ += other.replicates_;
+    }
+
+    void Reset()
+    {
+        *this = ReplicateStat{};
+    }
+
+    [[nodiscard]] auto GetReplicatesNum() const -> uint64_t
+    {
+        return replicates_;
+    }
+
+    [[nodiscard]] auto GetMean() const -> double
+    {
+        return (mean_[0] == 0.) ? 0. : mean_[1] / mean_[0];
+    }
+
+    [[nodiscard]] auto GetVariance() const -> double
+    {
+        const auto mean = GetMean();
+        return (mean_[0] == 0.) ? 0. : std::max(mean_[2] / mean_[0] - mean * mean, 0.);
+    }
+
+    [[nodiscard]] auto GetStdDev() const -> double
+    {
+        return std::sqrt(GetVariance());
+    }
+
+    // influence of a replicate on the mean: sum - mean * count
+    [[nodiscard]] auto GetMeanError() const -> double
+    {
+        const auto mean = GetMean();
+        return Linear_error({ -mean, 1., 0. });
+    }
+
+    // influence on the variance: sum2 - 2 mean sum + (2 mean^2 - second raw moment) count
+    [[nodiscard]] auto GetVarianceError() const -> double
+    {
+        const auto mean = GetMean();
+        const auto raw2 = (mean_[0] == 0.) ? 0. : mean_[2] / mean_[0];
+        return Linear_error({ 2 * mean * mean - raw2, -2 * mean, 1. });
+    }
+
+    // same meaning as the functions of RunningStat, for the stopping rule of MultiNomial
+    [[nodiscard]] auto GetMeanRelError() const -> double
+    {
+        const auto mean = GetMean();
+        return (replicates_ < 2 || mean == 0.) ? INFINITY : GetMeanError() / std::abs(mean);
+    }
+
+    [[nodiscard]] auto GetStdDevRelError() const -> double
+    {
+        const auto variance = GetVariance();
+        return (replicates_ < 2 || variance == 0.) ? INFINITY : GetVarianceError() / (2. * variance);
+    }
+
+  private:
+    uint64_t replicates_ = 0;
+    std::array<double, 3> mean_ = {};
+    std::array<std::array<double, 3>, 3> comoment_ = {};
+
+    // standard error of sum_r (weights . replicate_r) / sum_r count_r
+    [[nodiscard]] auto Linear_error(const std::array<double, 3>& weights) const -> double
+    {
+        if (replicates_ < 2 || mean_[0] == 0.)
+        {
+            return 0.;
+        }
+        auto variance = 0.;
+        for (std::size_t row{}; row < 3; ++row)
+        {
+            for (std::size_t column{}; column < 3; ++column)
+            {
+                variance += weights[row] * weights[column] * comoment_[row][column];
+            }
+        }
+        variance /= static_cast<double>(replicates_ - 1);
+        return std::sqrt(std::max(variance, 0.) / static_cast<double>(replicates_)) / mean_[0];
+    }
+};
@@ -0,0 +1,202 @@
+#include "SampleKernels.hpp"
+
+// The kernels are plain fixed-length loops written for the auto-vectorizer. With GCC/Clang on x86-64 they are
+// compiled for AVX-512, AVX2 and the baseline ISA, and the loader picks the best version for the running CPU.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(FINETIME_NO_DISPATCH)
+#define FINETIME_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define FINETIME_KERNEL
+#endif
+
+namespace
+{
+    constexpr uint32_t philox_multiplier_0 = 0xD2511F53;
+    constexpr uint32_t philox_multiplier_1 = 0xCD9E8D57;
+    constexpr uint32_t philox_weyl_0 = 0x9E3779B9;
+    constexpr uint32_t philox_weyl_1 = 0xBB67AE85;
+    constexpr int philox_rounds = 10;
+    constexpr unsigned int word_shift = 32;
+
+    // the four output words of Philox4x32 for every lane
+    using Philox_words = std::array<BatchArray<uint32_t>, 4>;
+
+    // Philox4x32::Block of the counters { block, first_sample + lane, stream } in structure-of-arrays layout
+    inline void Philox_lanes(const Philox4x32::Key& key,
+                             uint64_t stream,
+                             uint64_t first_sample,
+                             uint32_t block,
+                             Philox_words& words)
+    {
+        auto& [counter_0, counter_1, counter_2, counter_3] = words;
+        for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+        {
+            counter_0[lane] = block;
+            counter_1[lane] = static_cast<uint32_t>(first_sample + lane);
+            counter_2[lane] = static_cast<uint32_t>(stream);
+            counter_3[lane] = static_cast<uint32_t>(stream >> word_shift);
+        }
+
+        auto key_0 = key[0];
+        auto key_1 = key[1];
+        for (int round{}; round < philox_rounds; ++round)
+        {
+            for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+            {
+                const auto product_0 = uint64_t{ philox_multiplier_0 } * counter_0[lane];
+                const auto product_1 = uint64_t{ philox_multiplier_1 } * counter_2[lane];
+                const auto next_0 = static_cast<uint32_t>(product_1 >> word_shift) ^ counter_1[lane] ^ key_0;
+                const auto next_2 = static_cast<uint32_t>(product_0 >> word_shift) ^ counter_3[lane] ^ key_1;
+                counter_1[lane] = static_cast<uint32_t>(product_1);
+                counter_3[lane] = static_cast<uint32_t>(product_0);
+                counter_0[lane] = next_0;
+                counter_2[lane] = next_2;
+            }
+            key_0 += philox_weyl_0;
+            key_1 += philox_weyl_1;
+        }
+    }
+
+    // pairwise sum in a fixed order, so that every instruction set gives the same rounding
+    inline auto TreeSum(BatchArray<double> lanes) -> double
+    {
+        for (auto width = SAMPLE_BATCH_SIZE / 2; width > 0; width /= 2)
+        {
+            for (std::size_t lane{}; lane < width; ++lane)
+            {
+                lanes[lane] += lanes[lane + width];
+            }
+        }
+        return lanes[0];
+    }
+} // namespace
+
+FINETIME_KERNEL void FillSampleUniforms(const Philox4x32::Key& key,
+                                        uint64_t stream,
+                                        uint64_t first_sample,
+                                        BatchArray<double>& uniforms)
+{
+    auto words = Philox_words{};
+    Philox_lanes(key, stream, first_sample, CounterEngine::PLACEMENT_BLOCK, words);
+    for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+    {
+        uniforms[lane] = CounterEngine::ToUniform(words[0][lane], words[1][lane]);
+    }
+}
+
+FINETIME_KERNEL void FillDrawBlocks(const Philox4x32::Key& key,
+                                    uint64_t stream,
+                                    uint64_t first_sample,
+                                    BatchArray<Philox4x32::Counter>& blocks)
+{
+    auto words = Philox_words{};
+    Philox_lanes(key, stream, first_sample, 0, words);
+    for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+    {
+        blocks[lane] = { words[0][lane], words[1][lane], words[2][lane], words[3][lane] };
+    }
+}
+
+void TransformSampleUniforms(SamplingMode mode, BatchArray<double>& uniforms)
+{
+    constexpr auto strata = static_cast<double>(SAMPLE_BATCH_SIZE);
+    constexpr int mantissa_bits = 53;
+    constexpr int stratum_bits = std::countr_zero(SAMPLE_BATCH_SIZE);
+    constexpr double mantissa_scale = 9007199254740992.; // 2^53
+    switch (mode)
+    {
+        case SamplingMode::antithetic:
+        {
+            for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; lane += 2)
+            {
+                uniforms[lane + 1] = 1. - uniforms[lane];
+            }
+            break;
+        }
+        case SamplingMode::stratified:
+        {
+            for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+            {
+                uniforms[lane] = (static_cast<double>(lane) + uniforms[lane]) / strata;
+            }
+            break;
+        }
+        case SamplingMode::sobol:
+        {
+            // Owen's nested scrambling of the van der Corput points: the leading bit of the point of index j is the
+            // lowest bit of j and so on. Every leading bit is flipped by a random bit that depends on the bits above
+            // it, one per node of the binary tree of the strata. The trailing bits of every point are its own random
+            // bits, the full scrambling below the last level of the tree.
+            constexpr int point_bits = mantissa_bits - stratum_bits;
+            constexpr auto point_mask = (uint64_t{ 1 } << point_bits) - 1;
+            constexpr std::size_t flip_lanes = (SAMPLE_BATCH_SIZE + stratum_bits - 1) / stratum_bits;
+            auto bits = BatchArray<uint64_t>{};
+            for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+            {
+                bits[lane] = static_cast<uint64_t>(uniforms[lane] * mantissa_scale);
+            }
+            // the leading bits of the uniforms are not used otherwise, those of the first lanes give the flips
+            auto flips = uint64_t{};
+            for (std::size_t lane{}; lane < flip_lanes; ++lane)
+            {
+                flips |= (bits[lane] >> point_bits) << (lane * stratum_bits);
+            }
+            for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+            {
+                auto stratum = uint64_t{};
+                for (int level{}; level < stratum_bits; ++level)
+                {
+                    const auto node = (uint64_t{ 1 } << level) - 1 + stratum;
+                    const auto bit = ((lane >> level) & 1U) ^ ((flips >> node) & 1U);
+                    stratum = (stratum << 1U) | bit;
+                }
+                const auto point = (stratum << point_bits) | (bits[lane] & point_mask);
+                uniforms[lane] = (static_cast<double>(point) + 0.5) / mantissa_scale;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+FINETIME_KERNEL auto PlaceSampleBatch(const SampleBatch& batch,
+                                      const BatchArray<double>& uniforms,
+                                      BatchArray<double>& values,
+                                      BatchArray<double>& widths) -> CentralMoments
+{
+    // the central bin starts after the counts of the bins before it
+    auto is_filled = BatchArray<double>{};
+    auto filled_values = BatchArray<double>{};
+    for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+    {
+        const auto start = static_cast<double>(batch.before[lane]);
+        widths[lane] = static_cast<double>(batch.central[lane]);
+        is_filled[lane] = (widths[lane] > 0.) ? 1. : 0.;
+        values[lane] = start + uniforms[lane] * widths[lane];
+        filled_values[lane] = is_filled[lane] * values[lane];
+    }
+
+    auto moments = CentralMoments{};
+    const auto count = TreeSum(is_filled);
+    if (count == 0.)
+    {
+        return moments;
+    }
+    moments.count = static_cast<uint64_t>(count);
+    moments.mean = TreeSum(filled_values) / count;
+
+    auto delta2 = BatchArray<double>{};
+    auto delta3 = BatchArray<double>{};
+    auto delta4 = BatchArray<double>{};
+    for (std::size_t lane{}; lane < SAMPLE_BATCH_SIZE; ++lane)
+    {
+        const auto delta = (values[lane] - moments.mean) * is_filled[lane];
+        delta2[lane] = delta * delta;
+        delta3[lane] = delta2[lane] * delta;
+        delta4[lane] = delta2[lane] * delta2[lane];
+    }
+    moments.m2 = TreeSum(delta2);
+    moments.m3 = TreeSum(delta3);
+    moments.m4 = TreeSum(delta4);
+    return moments;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CounterRNG.hpp"
+#include "RunningStat.hpp"
+#include "traits.hpp"
+#include <array>
+#include <bit>
+#include <cstdint>
+
+constexpr std::size_t SAMPLE_BATCH_SIZE = 16;
+static_assert(std::has_single_bit(SAMPLE_BATCH_SIZE), "replicates have to tile the batches");
+
+// consecutive samples forming one replicate, they start at multiples of it
+constexpr auto GetReplicateSize(SamplingMode mode) -> std::size_t
+{
+    switch (mode)
+    {
+        case SamplingMode::antithetic:
+            return 2;
+        case SamplingMode::stratified:
+        case SamplingMode::sobol:
+            return SAMPLE_BATCH_SIZE;
+        default:
+            return 1;
+    }
+}
+
+template <typename Type>
+using BatchArray = std::array<Type, SAMPLE_BATCH_SIZE>;
+
+// Multinomial counts of consecutive samples in structure-of-arrays layout, as far as the in-bin position depends on
+// them: the sum over the bins before the central one, where the central bin starts, and the central count. Lanes from
+// size up to SAMPLE_BATCH_SIZE are padding and hold zero counts.
+struct SampleBatch
+{
+    uint64_t first_sample = 0;
+    std::size_t size = 0;
+    BatchArray<unsigned int> before = {};
+    BatchArray<unsigned int> central = {};
+};
+
+// sums the BinSize / 2 bins before the central one of a draw into the lane of a batch
+template <std::size_t BinSize>
+inline void SetBatchCounts(SampleBatch& batch, std::size_t lane, const std::array<unsigned int, BinSize>& entries)
+{
+    constexpr auto center = BinSize / 2;
+    batch.before[lane] = 0;
+    for (std::size_t bin{}; bin < center; ++bin)
+    {
+        batch.before[lane] += entries[bin];
+    }
+    batch.central[lane] = entries[center];
+}
+
+// CounterEngine::SampleUniform of the samples first_sample, ..., first_sample + SAMPLE_BATCH_SIZE - 1
+void FillSampleUniforms(const Philox4x32::Key& key,
+                        uint64_t stream,
+                        uint64_t first_sample,
+                        BatchArray<double>& uniforms);
+
+// The first Philox block of the multinomial draws of the samples first_sample, ..., first_sample +
+// SAMPLE_BATCH_SIZE - 1, see CounterEngine::SetSample(sample, first_block)
+void FillDrawBlocks(const Philox4x32::Key& key,
+                    uint64_t stream,
+                    uint64_t first_sample,
+                    BatchArray<Philox4x32::Counter>& blocks);
+
+// Turns the uniforms of FillSampleUniforms into the positions of the sampling mode, for a batch starting at a multiple
+// of SAMPLE_BATCH_SIZE. Every replicate only uses the uniforms of its own samples.
+void TransformSampleUniforms(SamplingMode mode, BatchArray<double>& uniforms);
+
+// Uniform positions inside the central bin and their moments. Samples with an empty central bin are skipped
+// and get a width of 0.
+auto PlaceSampleBatch(const SampleBatch& batch,
+                      const BatchArray<double>& uniforms,
+                      BatchArray<double>& values,
+                      BatchArray<double>& widths) -> CentralMoments;
@@ -1,16 +1,20 @@
 #pragma once
 
-#include "LineDrawer.hpp"
+#include "HistogramPool.hpp"
+#include "Telemetry.hpp"
 #include "traits.hpp"
-#include <TCanvas.h>
-#include <TH1.h>
+#include <condition_variable>
+#include <deque>
 #include <fmt/core.h>
 #include <fmt/ranges.h>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <mutex>
 #include <range/v3/view.hpp>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 template <int index, typename... T1>
@@ -49,6 +53,15 @@ auto GetNames(auto&& tuple)
     return names;
 }
 
+// appends one value to every column of the tuple, shared by the csv and the columnar writer
+template <typename... ColumnTypes>
+void Push_row(std::tuple<ColumnTypes...>& columns, auto&&... args)
+    requires Equal<sizeof...(args), sizeof...(ColumnTypes)>
+{
+    auto Pusher = [](auto&& left, auto&& right) { left.push_back(std::forward<decltype(right)>(right)); };
+    Apply_element_wise(Pusher, columns, std::make_tuple(std::forward<decltype(args)>(args)...));
+}
+
 class Sinker
 {
   public:
@@ -66,11 +79,24 @@ class CSVWriter : public Sinker
     {
     }
 
+    ~CSVWriter()
+    {
+        Stop_flusher();
+    }
+
+    CSVWriter(const CSVWriter&) = delete;
+    CSVWriter(CSVWriter&&) = delete;
+    auto operator=(const CSVWriter&) -> CSVWriter& = delete;
+    auto operator=(CSVWriter&&) -> CSVWriter& = delete;
+
     void add_row(auto&&... args)
         requires Equal<sizeof...(args), sizeof...(ColumnTypes)>
     {
-        auto Pusher = [](auto&& left, auto&& right) { left.push_back(std::forward<decltype(right)>(right)); };
-        Apply_element_wise(Pusher, columns_, std::make_tuple(std::forward<decltype(args)>(args)...));
+        Push_row(columns_, std::forward<decltype(args)>(args)...);
+        if (flush_threshold_ > 0 && std::get<0>(columns_).size() >= flush_threshold_)
+        {
+            Push_chunk();
+        }
     }
 
     void write() override
@@ -79,6 +105,14 @@ class CSVWriter : public Sinker
         {
             throw std::logic_error("csv output filename not specified!");
         }
+        auto timer = PhaseTimer{ Phase::write };
+        if (flush_threshold_ > 0)
+        {
+            Push_chunk();
+            Stop_flusher();
+            std::cout << "writing to file " << filename_ << " finished\n";
+            return;
+        }
         std::cout << "writing to file " << filename_ << "\n";
         auto ostream = std::ofstream(filename_.c_str(), std::ios_base::out | std::ios_base::trunc);
         write_to_file(ostream);
@@ -90,29 +124,134 @@ class CSVWriter : public Sinker
         filename_ = filename;
     }
 
-    void operator()(const auto& result)
+    // Streaming mode: every `rows` rows the columns are handed to a background thread, which formats them and
+    // appends them to the file while new rows come in. At most max_pending_chunks chunks wait for the thread,
+    // add_row blocks beyond that. 0 keeps all rows in memory until write().
+    void SetFlushThreshold(std::size_t rows)
+    {
+        flush_threshold_ = rows;
+    }
+
+    void operator()(auto& result)
     {
         write_strategy_(this, result);
     }
 
   private:
+    static constexpr std::size_t max_pending_chunks = 4;
     std::tuple<ColumnTypes...> columns_;
     std::vector<std::string> names_;
     std::string filename_;
     WriteStrategy write_strategy_;
 
+    std::size_t flush_threshold_ = 0;
+    std::deque<std::tuple<ColumnTypes...>> pending_chunks_;
+    bool is_flush_finished_ = false;
+    bool is_file_started_ = false; // only touched by the flusher threads, which never run at the same time
+    std::mutex mu_chunks_;
+    std::condition_variable cv_chunks_;
+    std::thread flusher_;
+
     void write_to_file(auto& ostream)
+    {
+        write_header(ostream);
+        write_rows(ostream, columns_);
+    }
+
+    void write_header(auto& ostream)
     {
         ostream << fmt::format("{}\n", fmt::join(names_, ", "));
+    }
 
+    static void write_rows(auto& ostream, const std::tuple<ColumnTypes...>& columns)
+    {
         auto Join = [](auto&&... args)
         { return fmt::format("{}\n", fmt::join(std::make_tuple(std::forward<decltype(args)>(args)...), ", ")); };
 
-        for (const auto& line : GetZipViewer(Join, columns_))
+        for (const auto& line : GetZipViewer(Join, columns))
         {
             ostream << line;
         }
     }
+
+    void Push_chunk()
+    {
+        if (!flusher_.joinable())
+        {
+            if (filename_.empty())
+            {
+                throw std::logic_error("csv output filename not specified!");
+            }
+            is_flush_finished_ = false;
+            std::cout << "streaming to file " << filename_ << "\n";
+            flusher_ = std::thread{ [this]() { Flush_chunks(); } };
+        }
+        auto empty_columns = Empty_columns();
+
+        auto lock = std::unique_lock{ mu_chunks_ };
+        if (pending_chunks_.size() >= max_pending_chunks)
+        {
+            auto timer = PhaseTimer{ Phase::lock_wait };
+            cv_chunks_.wait(lock, [this]() { return pending_chunks_.size() < max_pending_chunks; });
+        }
+        pending_chunks_.emplace_back(std::exchange(columns_, std::move(empty_columns)));
+        cv_chunks_.notify_all();
+    }
+
+    auto Empty_columns() const -> std::tuple<ColumnTypes...>
+    {
+        auto Make_empty = [this](const auto&... columns)
+        {
+            auto empty = std::make_tuple(std::remove_cvref_t<decltype(columns)>{ columns.get_name() }...);
+            std::apply([this](auto&... empty_columns) { (empty_columns.reserve(flush_threshold_), ...); }, empty);
+            return empty;
+        };
+        return std::apply(Make_empty, columns_);
+    }
+
+    void Flush_chunks()
+    {
+        Telemetry::SetThreadName("csv flusher");
+        // a flusher started again after write() appends to the rows streamed before
+        const auto open_mode = is_file_started_ ? std::ios_base::app : std::ios_base::trunc;
+        auto ostream = std::ofstream(filename_.c_str(), std::ios_base::out | open_mode);
+        if (!is_file_started_)
+        {
+            write_header(ostream);
+            is_file_started_ = true;
+        }
+        while (true)
+        {
+            auto lock = std::unique_lock{ mu_chunks_ };
+            cv_chunks_.wait(lock, [this]() { return !pending_chunks_.empty() || is_flush_finished_; });
+            if (pending_chunks_.empty())
+            {
+                return;
+            }
+            auto chunk = std::move(pending_chunks_.front());
+            pending_chunks_.pop_front();
+            cv_chunks_.notify_all();
+            lock.unlock();
+
+            auto timer = PhaseTimer{ Phase::write };
+            write_rows(ostream, chunk);
+            ostream.flush();
+        }
+    }
+
+    void Stop_flusher()
+    {
+        if (!flusher_.joinable())
+        {
+            return;
+        }
+        {
+            auto lock = std::scoped_lock{ mu_chunks_ };
+            is_flush_finished_ = true;
+        }
+        cv_chunks_.notify_all();
+        flusher_.join();
+    }
 };
 
 template <typename DataType>
@@ -135,6 +274,16 @@ class CSVColumn
         return name_;
     }
 
+    [[nodiscard]] auto size() const -> std::size_t
+    {
+        return data_.size();
+    }
+
+    void reserve(std::size_t size)
+    {
+        data_.reserve(size);
+    }
+
     void push_back(auto&& value)
         requires Constructible_from<Type, decltype(value)>
     {
@@ -146,52 +295,142 @@ class CSVColumn
     std::vector<DataType> data_;
 };
 
+// one csv row per bin with its lower and upper edge and its weighted content, skipping empty bins if asked to
+inline void Write_histogram_rows(std::ostream& ostream,
+                                 const Histogram& histogram,
+                                 std::string_view prefix,
+                                 bool is_skipping_empty)
+{
+    const auto width = (histogram.GetHigh() - histogram.GetLow()) / static_cast<double>(histogram.GetBinsNum());
+    for (std::size_t bin = 1; bin <= histogram.GetBinsNum(); ++bin)
+    {
+        if (is_skipping_empty && histogram.GetBinContent(bin) == 0)
+        {
+            continue;
+        }
+        const auto low = histogram.GetLow() + static_cast<double>(bin - 1) * width;
+        ostream << fmt::format("{}{}, {}, {}\n", prefix, low, low + width, histogram.GetWeightedContent(bin));
+    }
+}
+
+// Takes over the histogram of a single point and writes its bins as csv. The boundaries of the central bin are
+// printed. See HistDrawer for the drawing with ROOT.
 template <typename WriteStrategy>
-class HistDrawer : public Sinker
+class HistWriter : public Sinker
 {
   public:
-    HistDrawer(std::string_view filename, WriteStrategy&& strategy)
+    HistWriter(std::string_view filename, WriteStrategy&& strategy)
         : filename_{ filename }
         , write_strategy_{ std::forward<WriteStrategy>(strategy) }
     {
     }
 
-    virtual void write()
+    void write() override
     {
-        constexpr int default_canvas_width = 1000;
-        constexpr int default_canvas_height = 800;
-        auto canvas = TCanvas{ "canvas", "canvas", default_canvas_width, default_canvas_height };
-        fmt::print("histogram total entries: {}\n", histogram_->GetEntries());
-        histogram_->Draw();
-        canvas.Update();
-
-        auto linesDraw = LineDrawer(2);
-        const auto& [start, end] = boundaries_;
-        auto lineL = linesDraw.Draw_vLine(&canvas, start);
-        auto lineR = linesDraw.Draw_vLine(&canvas, end);
-        lineL->Draw();
-        lineR->Draw();
-
-        canvas.SaveAs(filename_.c_str());
+        auto timer = PhaseTimer{ Phase::write };
+        auto ostream = std::ofstream{ filename_, std::ios_base::out | std::ios_base::trunc };
+        ostream << "low, high, count\n";
+        Write_histogram_rows(ostream, GetHistogram(), "", false);
+        fmt::print("histogram total entries: {}, central bin [{}, {}), written to {}\n",
+                   GetHistogram().GetEntries(),
+                   boundaries_.first,
+                   boundaries_.second,
+                   filename_);
     }
 
-    void operator()(const auto& result)
+    void operator()(auto& result)
     {
         write_strategy_(this, result);
     }
 
-    void Set(const Parallel_run_output& result)
+    void Set(Parallel_run_output& result)
     {
-        // fmt::print("setting process: histogram total entries: {}\n", result.histogram->GetEntries());
-        histogram_ = std::unique_ptr<TH1>(static_cast<TH1*>(result.histogram->Clone()));
-        // fmt::print("pa {},pb {},pc {}, entryN {}", result.pre_prob, result.mid_prob, result.post_prob,
-        // result.entryN);
+        if (result.histogram == nullptr)
+        {
+            throw std::logic_error("HistWriter requires a result with histogram!");
+        }
+        histogram_ = std::move(result.histogram);
         boundaries_ = { result.pre_prob * result.entryN, (1 - result.post_prob) * result.entryN };
     }
 
+  protected:
+    [[nodiscard]] auto GetFileName() const -> const std::string&
+    {
+        return filename_;
+    }
+    [[nodiscard]] auto GetBoundaries() const -> std::pair<double, double>
+    {
+        return boundaries_;
+    }
+    [[nodiscard]] auto GetHistogram() const -> const Histogram&
+    {
+        if (histogram_ == nullptr)
+        {
+            throw std::logic_error(fmt::format("no histogram was set for {}!", filename_));
+        }
+        return *histogram_;
+    }
+
   private:
     std::string filename_;
     std::pair<double, double> boundaries_;
-    std::unique_ptr<TH1> histogram_;
+    HistogramHandle histogram_;
     std::remove_const_t<WriteStrategy> write_strategy_;
 };
+
+// Writes the non-empty bins of every point of a sweep into one long csv table. The rows of a point are written as
+// soon as its result arrives and its histogram goes back to the pool right away, so a sweep of many points holds
+// only the histograms of the points in flight.
+template <typename WriteStrategy>
+class HistCollector : public Sinker
+{
+  public:
+    HistCollector(std::string_view filename, WriteStrategy&& strategy)
+        : filename_{ filename }
+        , write_strategy_{ std::forward<WriteStrategy>(strategy) }
+    {
+    }
+
+    void write() override
+    {
+        Open();
+        ostream_.close();
+        std::cout << "writing to file " << filename_ << " finished\n";
+    }
+
+    void operator()(auto& result)
+    {
+        write_strategy_(this, result);
+    }
+
+    // results without histogram are ignored
+    void Add(Parallel_run_output& result)
+    {
+        if (result.histogram == nullptr)
+        {
+            return;
+        }
+        Open();
+        auto timer = PhaseTimer{ Phase::write };
+        const auto prefix =
+            fmt::format("{}, {}, {}, {}, ", result.entryN, result.pre_prob, result.mid_prob, result.post_prob);
+        Write_histogram_rows(ostream_, *result.histogram, prefix, true);
+        result.histogram.reset(); // back to the pool
+    }
+
+  private:
+    std::string filename_;
+    std::ofstream ostream_;
+    std::remove_const_t<WriteStrategy> write_strategy_;
+
+    void Open()
+    {
+        if (ostream_.is_open())
+        {
+            return;
+        }
+        std::cout << "writing to file " << filename_ << "\n";
+        ostream_.open(filename_, std::ios_base::out | std::ios_base::trunc);
+        ostream_ << "entryN, pa, pb, pc, low, high, count\n";
+    }
+};
@@ -0,0 +1,121 @@
+#include "TaskPool.hpp"
+#include "Telemetry.hpp"
+#include <string>
+#include <utility>
+
+TaskPool::TaskPool(unsigned int num_workers)
+{
+    num_workers = (num_workers == 0) ? 1 : num_workers;
+    queues_.reserve(num_workers);
+    for (unsigned int index{}; index < num_workers; ++index)
+    {
+        queues_.emplace_back(std::make_unique<TaskQueue>());
+    }
+    workers_.reserve(num_workers);
+    for (unsigned int index{}; index < num_workers; ++index)
+    {
+        workers_.emplace_back([this, index]() { Work(index); });
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        auto lock = std::scoped_lock{ mu_state_ };
+        is_stopping_ = true;
+    }
+    cv_work_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void TaskPool::Submit(Task task, unsigned int queue_index)
+{
+    auto& queue = *queues_[queue_index % queues_.size()];
+    {
+        auto lock = std::scoped_lock{ mu_state_, queue.mutex };
+        queue.tasks.emplace_back(std::move(task));
+        ++pending_num_;
+        ++queued_num_;
+    }
+    cv_work_.notify_one();
+}
+
+void TaskPool::Wait()
+{
+    auto lock = std::unique_lock{ mu_state_ };
+    cv_done_.wait(lock, [this]() { return pending_num_ == 0; });
+    if (exception_ != nullptr)
+    {
+        std::rethrow_exception(std::exchange(exception_, nullptr));
+    }
+}
+
+auto TaskPool::Pop(unsigned int index) -> std::optional<Task>
+{
+    const auto queues_num = queues_.size();
+    for (std::size_t offset{}; offset < queues_num; ++offset)
+    {
+        auto& queue = *queues_[(index + offset) % queues_num];
+        auto lock = LockTimed(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+        auto task = std::optional<Task>{};
+        if (offset == 0)
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        else
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        --queued_num_;
+        return task;
+    }
+    return {};
+}
+
+void TaskPool::Work(unsigned int index)
+{
+    Telemetry::SetThreadName("worker " + std::to_string(index));
+    while (true)
+    {
+        auto task = Pop(index);
+        if (!task.has_value())
+        {
+            auto timer = PhaseTimer{ Phase::idle };
+            auto lock = std::unique_lock{ mu_state_ };
+            cv_work_.wait(lock, [this]() { return is_stopping_ || queued_num_ > 0; });
+            if (is_stopping_ && queued_num_ == 0)
+            {
+                return;
+            }
+            continue;
+        }
+
+        try
+        {
+            (*task)(index);
+        }
+        catch (...)
+        {
+            auto lock = std::scoped_lock{ mu_state_ };
+            if (exception_ == nullptr)
+            {
+                exception_ = std::current_exception();
+            }
+        }
+
+        auto lock = std::scoped_lock{ mu_state_ };
+        if (--pending_num_ == 0)
+        {
+            cv_done_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Persistent pool of workers with one task queue each. A worker takes tasks from the front of its own queue and,
+// once that is empty, steals from the back of the others. Tasks receive the index of the worker running them.
+class TaskPool
+{
+  public:
+    using Task = std::function<void(unsigned int)>;
+
+    explicit TaskPool(unsigned int num_workers);
+    ~TaskPool();
+    TaskPool(const TaskPool&) = delete;
+    TaskPool(TaskPool&&) = delete;
+    auto operator=(const TaskPool&) -> TaskPool& = delete;
+    auto operator=(TaskPool&&) -> TaskPool& = delete;
+
+    void Submit(Task task, unsigned int queue_index);
+
+    // blocks until every submitted task has finished and rethrows the first exception thrown by a task
+    void Wait();
+
+    [[nodiscard]] auto GetWorkersNum() const -> unsigned int
+    {
+        return static_cast<unsigned int>(queues_.size());
+    }
+
+  private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::atomic<std::size_t> queued_num_ = 0;
+    std::size_t pending_num_ = 0;
+    bool is_stopping_ = false;
+    std::exception_ptr exception_;
+    std::mutex mu_state_;
+    std::condition_variable cv_work_;
+    std::condition_variable cv_done_;
+    std::vector<std::thread> workers_;
+
+    void Work(unsigned int index);
+    auto Pop(unsigned int index) -> std::optional<Task>;
+};
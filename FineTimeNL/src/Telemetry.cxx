@@ -0,0 +1,126 @@
+#include "Telemetry.hpp"
+#include <deque>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// the deque keeps the addresses of registered counters stable
+static auto mu_registry = std::mutex{};
+static auto registry = std::deque<Telemetry::Thread_stats>{};
+
+auto Telemetry::Local() -> Thread_stats&
+{
+    thread_local auto* stats = []()
+    {
+        auto lock = std::scoped_lock{ mu_registry };
+        auto& new_stats = registry.emplace_back();
+        new_stats.name = fmt::format("thread {}", registry.size() - 1);
+        return &new_stats;
+    }();
+    return *stats;
+}
+
+void Telemetry::SetThreadName(std::string_view name)
+{
+    if constexpr (is_enabled)
+    {
+        auto& stats = Local();
+        auto lock = std::scoped_lock{ mu_registry };
+        stats.name = name;
+    }
+}
+
+struct Stats_summary
+{
+    std::string name;
+    std::array<double, PHASE_NUM> seconds = {};
+    std::array<uint64_t, COUNTER_NUM> counts = {};
+};
+
+static auto Summarize() -> std::vector<Stats_summary>
+{
+    auto lock = std::scoped_lock{ mu_registry };
+    auto summaries = std::vector<Stats_summary>{};
+    auto total = Stats_summary{ .name = "total" };
+    for (const auto& stats : registry)
+    {
+        auto& summary = summaries.emplace_back(Stats_summary{ .name = stats.name });
+        for (std::size_t phase{}; phase < PHASE_NUM; ++phase)
+        {
+            summary.seconds[phase] = 1e-9 * static_cast<double>(stats.nanoseconds[phase].load());
+            total.seconds[phase] += summary.seconds[phase];
+        }
+        for (std::size_t counter{}; counter < COUNTER_NUM; ++counter)
+        {
+            summary.counts[counter] = stats.counts[counter].load();
+            total.counts[counter] += summary.counts[counter];
+        }
+    }
+    summaries.push_back(std::move(total));
+    return summaries;
+}
+
+void Telemetry::Print(std::ostream& ostream, std::chrono::duration<double> wall_time)
+{
+    if constexpr (!is_enabled)
+    {
+        ostream << "telemetry is not compiled in, configure with -DFINETIME_TELEMETRY=ON\n";
+        return;
+    }
+    const auto samples_index = static_cast<std::size_t>(Counter::samples);
+    ostream << fmt::format("telemetry over {:.3f} s, times in seconds\n", wall_time.count());
+    ostream << fmt::format("{:<12} {:>12} {:>12}", "thread", "samples", "samples/s");
+    for (const auto& phase_name : PHASE_NAMES)
+    {
+        ostream << fmt::format(" {:>10}", phase_name);
+    }
+    ostream << "\n";
+    for (const auto& summary : Summarize())
+    {
+        ostream << fmt::format("{:<12} {:>12} {:>12.4g}",
+                               summary.name,
+                               summary.counts[samples_index],
+                               static_cast<double>(summary.counts[samples_index]) / wall_time.count());
+        for (const auto& seconds : summary.seconds)
+        {
+            ostream << fmt::format(" {:>10.4f}", seconds);
+        }
+        ostream << "\n";
+    }
+}
+
+void Telemetry::WriteJson(const std::string& filename, std::chrono::duration<double> wall_time)
+{
+    auto Format_summary = [&wall_time](const Stats_summary& summary)
+    {
+        const auto samples = summary.counts[static_cast<std::size_t>(Counter::samples)];
+        auto json = fmt::format("{{\"name\": \"{}\", \"samples_per_second\": {}",
+                                summary.name,
+                                static_cast<double>(samples) / wall_time.count());
+        for (std::size_t counter{}; counter < COUNTER_NUM; ++counter)
+        {
+            json += fmt::format(", \"{}\": {}", COUNTER_NAMES[counter], summary.counts[counter]);
+        }
+        for (std::size_t phase{}; phase < PHASE_NUM; ++phase)
+        {
+            json += fmt::format(", \"{}_seconds\": {}", PHASE_NAMES[phase], summary.seconds[phase]);
+        }
+        return json + "}";
+    };
+
+    auto ostream = std::ofstream{ filename, std::ios_base::out | std::ios_base::trunc };
+    ostream << fmt::format("{{\n  \"enabled\": {},\n  \"wall_seconds\": {}", is_enabled, wall_time.count());
+    if constexpr (is_enabled)
+    {
+        const auto summaries = Summarize();
+        ostream << ",\n  \"threads\": [";
+        for (std::size_t index{}; index + 1 < summaries.size(); ++index)
+        {
+            ostream << ((index == 0) ? "\n    " : ",\n    ") << Format_summary(summaries[index]);
+        }
+        ostream << "\n  ],\n  \"total\": " << Format_summary(summaries.back());
+    }
+    ostream << "\n}\n";
+    std::cout << "telemetry written to " << filename << "\n";
+}
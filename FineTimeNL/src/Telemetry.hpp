@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Hot path instrumentation, compiled in with FINETIME_TELEMETRY=1 (CMake option FINETIME_TELEMETRY). Each thread
+// owns its counters and is the only one writing them, so recording takes neither locks nor read-modify-write
+// atomics. Without the option timers and counters are empty and compile away.
+#ifndef FINETIME_TELEMETRY
+#define FINETIME_TELEMETRY 0
+#endif
+
+enum class Phase : uint8_t
+{
+    draw,      // multinomial draws
+    insert,    // placement inside the central bin, moments and histogram
+    record,    // handing a finished point to the output queue and the checkpoint
+    flush,     // passing the queued results to the writers
+    write,     // writing output files
+    lock_wait, // waiting for a contended mutex or a full queue
+    idle,      // pool worker without tasks
+};
+constexpr std::size_t PHASE_NUM = 7;
+constexpr auto PHASE_NAMES =
+    std::array<std::string_view, PHASE_NUM>{ "draw", "insert", "record", "flush", "write", "lock_wait", "idle" };
+
+enum class Counter : uint8_t
+{
+    samples,
+    points,
+};
+constexpr std::size_t COUNTER_NUM = 2;
+constexpr auto COUNTER_NAMES = std::array<std::string_view, COUNTER_NUM>{ "samples", "points" };
+
+class Telemetry
+{
+  public:
+    static constexpr bool is_enabled = FINETIME_TELEMETRY != 0;
+
+    struct Thread_stats
+    {
+        std::string name;
+        std::array<std::atomic<uint64_t>, PHASE_NUM> nanoseconds = {};
+        std::array<std::atomic<uint64_t>, COUNTER_NUM> counts = {};
+    };
+
+    // counters of the calling thread, registered on first use and kept after the thread has finished
+    static auto Local() -> Thread_stats&;
+    static void SetThreadName(std::string_view name);
+
+    static void Add(Counter counter, uint64_t value)
+    {
+        if constexpr (is_enabled)
+        {
+            Increase(Local().counts[static_cast<std::size_t>(counter)], value);
+        }
+    }
+
+    static void AddTime(Phase phase, std::chrono::steady_clock::duration duration)
+    {
+        if constexpr (is_enabled)
+        {
+            Increase(Local().nanoseconds[static_cast<std::size_t>(phase)],
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        }
+    }
+
+    // table per thread with the rates relative to the wall time of the run
+    static void Print(std::ostream& ostream, std::chrono::duration<double> wall_time);
+    static void WriteJson(const std::string& filename, std::chrono::duration<double> wall_time);
+
+  private:
+    static void Increase(std::atomic<uint64_t>& count, uint64_t value)
+    {
+        count.store(count.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+// adds its lifetime to a phase of the calling thread
+class PhaseTimer
+{
+  public:
+    explicit PhaseTimer(Phase phase)
+        : phase_{ phase }
+    {
+        if constexpr (Telemetry::is_enabled)
+        {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PhaseTimer()
+    {
+        if constexpr (Telemetry::is_enabled)
+        {
+            Telemetry::AddTime(phase_, std::chrono::steady_clock::now() - start_);
+        }
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer(PhaseTimer&&) = delete;
+    auto operator=(const PhaseTimer&) -> PhaseTimer& = delete;
+    auto operator=(PhaseTimer&&) -> PhaseTimer& = delete;
+
+  private:
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// locks the mutex and counts the time as lock_wait if it was held by another thread
+inline auto LockTimed(std::mutex& mutex) -> std::unique_lock<std::mutex>
+{
+    if constexpr (!Telemetry::is_enabled)
+    {
+        return std::unique_lock{ mutex };
+    }
+    auto lock = std::unique_lock{ mutex, std::try_to_lock };
+    if (!lock.owns_lock())
+    {
+        auto timer = PhaseTimer{ Phase::lock_wait };
+        lock.lock();
+    }
+    return lock;
+}
@@ -1,12 +1,14 @@
 #pragma once
 
-#include "LineDrawer.hpp"
+#include "CounterRNG.hpp"
+#include "HistogramPool.hpp"
+#include "RunningStat.hpp"
+#include "SampleKernels.hpp"
 #include "traits.hpp"
-#include <Math/GSLRndmEngines.h>
-#include <TCanvas.h>
-#include <TH1I.h>
 #include <fmt/core.h>
+#include <memory>
 #include <numeric>
+#include <utility>
 
 extern const unsigned int SEED_NUM;
 
@@ -26,6 +28,33 @@ auto GetCenterBoundary(const auto& vec, double multiplier = 1)
     return std::make_pair(start * multiplier, end * multiplier);
 }
 
+// same for a fixed number of bins, with the sum over the leading bins unrolled at compile time
+template <typename Type, std::size_t BinSize>
+constexpr auto GetCenterBoundary(const std::array<Type, BinSize>& entries, double multiplier = 1)
+{
+    static_assert(BinSize % 2 == 1 && BinSize >= 3, "the central bin needs an odd number of bins");
+    const auto start = [&entries]<std::size_t... indices>(std::index_sequence<indices...>)
+    { return (0. + ... + entries[indices]); }(std::make_index_sequence<BinSize / 2>{});
+    const auto end = start + entries[BinSize / 2];
+    return std::make_pair(start * multiplier, end * multiplier);
+}
+
+// Monte Carlo error of the mean, from the spread between the replicates unless the samples are independent
+inline auto GetMeanError(SamplingMode mode, const RunningStat<true>& stat, const ReplicateStat& replicates) -> double
+{
+    if (mode != SamplingMode::plain)
+    {
+        return replicates.GetMeanError();
+    }
+    return (stat.GetCount() == 0) ? 0. : stat.GetStdDev() / std::sqrt(static_cast<double>(stat.GetCount()));
+}
+
+enum class InserterMode
+{
+    histogram,
+    statistics // only running moments, no histogram is filled
+};
+
 class UniformInserter
 {
   public:
@@ -35,35 +64,108 @@ class UniformInserter
     auto operator=(const UniformInserter&) -> UniformInserter& = delete;
     auto operator=(UniformInserter&&) -> UniformInserter& = default;
 
-    explicit UniformInserter(unsigned int num, std::string_view histname)
+    // the histogram is taken from pool if given
+    explicit UniformInserter(unsigned int num,
+                             InserterMode mode = InserterMode::histogram,
+                             HistogramPool* pool = nullptr)
+        : engine_{ SEED_NUM }
+    {
+        if (mode == InserterMode::histogram)
+        {
+            constexpr std::size_t hist_entries = 10000;
+            histogram_ = (pool != nullptr) ? pool->Acquire(hist_entries, 0., static_cast<double>(num))
+                                           : Make_histogram(hist_entries, 0., static_cast<double>(num));
+        }
+    }
+
+    // samples have to arrive in order when the sampling mode is not plain, the replicates are built from them
+    void SetSamplingMode(SamplingMode mode)
+    {
+        sampling_ = mode;
+        is_batch_cached_ = false;
+    }
+
+    // importance weight of the samples, see Histogram::SetWeight. It is the same for all samples of a point, the
+    // weighted mean and spread are thus those of the samples.
+    void SetSampleWeight(double weight)
     {
-        engine_.Initialize();
-        engine_.SetSeed(SEED_NUM);
-        TH1::AddDirectory(false);
-        constexpr int hist_entries = 10000;
-        constexpr int histBin_entries = 100;
-        histogram_ = std::make_unique<TH1I>(histname.data(), histname.data(), hist_entries, 0, num);
+        if (histogram_ != nullptr)
+        {
+            histogram_->SetWeight(weight);
+        }
     }
 
     void operator()(const auto& vec)
     {
         const auto [start, end] = GetCenterBoundary(vec);
+        const auto sample = engine_.GetSample();
         if (start == end)
         {
+            Add_to_replicate(sample, 0., 0.);
             return;
         }
-        auto binValue = engine_.Rndm() * static_cast<double>(end - start);
+        auto binValue = Sample_position(sample) * static_cast<double>(end - start);
         auto value = binValue + static_cast<double>(start);
-        histogram_->Fill(value);
+        stat_.Push(value);
+        Add_to_replicate(sample, 1., value);
+        if (histogram_ != nullptr)
+        {
+            histogram_->Fill(value);
+        }
         // Print(fmt::format("filling histogram with entries {}\n", histogram_->GetEntries()));
         // histogramBin_->Fill(binValue);
     }
 
-    [[nodiscard]] auto GetCloneHist() -> std::unique_ptr<TH1>
+    void Insert_batch(const SampleBatch& batch)
+    {
+        auto positions = BatchArray<double>{};
+        FillSampleUniforms(engine_.GetKey(), engine_.GetStream(), batch.first_sample, positions);
+        if (sampling_ != SamplingMode::plain)
+        {
+            if (batch.first_sample % SAMPLE_BATCH_SIZE != 0)
+            {
+                throw std::logic_error("batches of variance reduced sampling have to start at a batch boundary!");
+            }
+            TransformSampleUniforms(sampling_, positions);
+        }
+        Insert_batch(batch, positions);
+    }
+
+    // with in-bin positions computed elsewhere, e.g. shared by several points
+    void Insert_batch(const SampleBatch& batch, const BatchArray<double>& positions)
+    {
+        auto values = BatchArray<double>{};
+        auto widths = BatchArray<double>{};
+        const auto batch_stat = RunningStat<true>{ PlaceSampleBatch(batch, positions, values, widths) };
+        stat_.Merge(batch_stat);
+        if (sampling_ != SamplingMode::plain)
+        {
+            for (std::size_t lane{}; lane < batch.size; ++lane)
+            {
+                const auto is_filled = (widths[lane] > 0.) ? 1. : 0.;
+                Add_to_replicate(batch.first_sample + lane, is_filled, is_filled * values[lane]);
+            }
+        }
+        if (histogram_ == nullptr)
+        {
+            return;
+        }
+        for (std::size_t lane{}; lane < batch.size; ++lane)
+        {
+            if (widths[lane] > 0.)
+            {
+                histogram_->AddCount(values[lane]);
+            }
+        }
+        histogram_->AddMoments(batch_stat);
+    }
+
+    // hands over the filled histogram, the inserter fills none afterwards
+    [[nodiscard]] auto ReleaseHist() -> HistogramHandle
     {
-        return std::unique_ptr<TH1>(static_cast<TH1*>(histogram_->Clone()));
+        return std::move(histogram_);
     }
-    [[nodiscard]] auto GetHist() -> TH1*
+    [[nodiscard]] auto GetHist() -> Histogram*
     {
         // Print("passing here......");
         // Print(fmt::format("getting histogram with entries {}\n", histogram_->GetEntries()));
@@ -83,7 +185,34 @@ class UniformInserter
 
     void Reset()
     {
-        histogram_->Reset("M");
+        stat_.Reset();
+        replicates_.Reset();
+        pending_ = {};
+        is_batch_cached_ = false;
+        if (histogram_ != nullptr)
+        {
+            histogram_->Reset();
+        }
+    }
+
+    [[nodiscard]] auto GetStat() const -> const auto&
+    {
+        return stat_;
+    }
+
+    [[nodiscard]] auto GetReplicates() const -> const ReplicateStat&
+    {
+        return replicates_;
+    }
+
+    // relative errors for the precision target of MultiNomial, valid for every sampling mode
+    [[nodiscard]] auto GetMeanRelError() const -> double
+    {
+        return (sampling_ == SamplingMode::plain) ? stat_.GetMeanRelError() : replicates_.GetMeanRelError();
+    }
+    [[nodiscard]] auto GetStdDevRelError() const -> double
+    {
+        return (sampling_ == SamplingMode::plain) ? stat_.GetStdDevRelError() : replicates_.GetStdDevRelError();
     }
 
     // void DrawAll(std::pair<double, double> boundary, std::string_view filename = "distri")
@@ -97,28 +226,63 @@ class UniformInserter
     }
 
   private:
-    std::unique_ptr<TH1I> histogram_;
-    ROOT::Math::GSLRandomEngine engine_ = {};
+    HistogramHandle histogram_;
+    CounterEngine engine_;
+    RunningStat<true> stat_; // higher moments for the precision target of MultiNomial
+    SamplingMode sampling_ = SamplingMode::plain;
+    ReplicateStat replicates_;            // only filled if the sampling mode is not plain
+    std::array<double, 3> pending_ = {}; // count, sum and sum of squares of the unfinished replicate
     MeanError result_;
+    // transformed positions of the batch of the last sample placed one by one
+    BatchArray<double> cached_positions_ = {};
+    uint64_t cached_first_sample_ = 0;
+    uint64_t cached_stream_ = 0;
+    bool is_batch_cached_ = false;
 
     void SetResult()
     {
-        auto mean = static_cast<float>(histogram_->GetMean());
-        auto err = static_cast<float>(histogram_->GetStdDev());
+        auto mean = static_cast<float>(stat_.GetMean());
+        auto err = static_cast<float>(stat_.GetStdDev());
         if (err == 0)
         {
-            Print(fmt::format("WARN: 0 stderr! histogram entries: {}", histogram_->GetEntries()));
+            Print(fmt::format("WARN: 0 stderr! sample entries: {}", stat_.GetCount()));
+        }
+        result_ = MeanError{ mean, err, static_cast<float>(GetMeanError(sampling_, stat_, replicates_)) };
+    }
+
+    // position of a single sample, computed with the batch it belongs to when the mode correlates the samples
+    [[nodiscard]] auto Sample_position(uint64_t sample) -> double
+    {
+        if (sampling_ == SamplingMode::plain)
+        {
+            return engine_.SampleUniform();
+        }
+        const auto lane = sample % SAMPLE_BATCH_SIZE;
+        const auto first_sample = sample - lane;
+        if (!is_batch_cached_ || first_sample != cached_first_sample_ || engine_.GetStream() != cached_stream_)
+        {
+            FillSampleUniforms(engine_.GetKey(), engine_.GetStream(), first_sample, cached_positions_);
+            TransformSampleUniforms(sampling_, cached_positions_);
+            cached_first_sample_ = first_sample;
+            cached_stream_ = engine_.GetStream();
+            is_batch_cached_ = true;
         }
-        result_ = MeanError{ mean, err };
+        return cached_positions_[lane];
     }
 
-    static void Draw(std::string_view filename, TH1* hist)
+    void Add_to_replicate(uint64_t sample, double count, double value)
     {
-        constexpr int default_canvas_width = 1000;
-        constexpr int default_canvas_height = 800;
-        auto canvas = TCanvas{ "canvas", "canvas", default_canvas_width, default_canvas_height };
-        hist->Draw();
-        canvas.Update();
-        canvas.SaveAs(filename.data());
+        if (sampling_ == SamplingMode::plain)
+        {
+            return;
+        }
+        pending_[0] += count;
+        pending_[1] += value;
+        pending_[2] += value * value;
+        if ((sample + 1) % GetReplicateSize(sampling_) == 0)
+        {
+            replicates_.Push(pending_[0], pending_[1], pending_[2]);
+            pending_ = {};
+        }
     }
 };
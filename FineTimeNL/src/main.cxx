@@ -1,5 +1,11 @@
+#include "ColumnarWriter.hpp"
 #include "FineTimeMC.hpp"
+#include "ModelChecker.hpp"
 #include "Sinker.hpp"
+#ifdef FINETIME_WITH_ROOT
+#include "HistDrawer.hpp"
+#endif
+#include <charconv>
 #include <chrono>
 #include <cxxopts.hpp>
 #include <iostream>
@@ -12,7 +18,8 @@ enum class Mode
     none,
     pa,
     entryN,
-    fix
+    fix,
+    grid
 };
 
 Mode Str2Mode(std::string_view name)
@@ -29,6 +36,10 @@ Mode Str2Mode(std::string_view name)
     {
         return Mode::fix;
     }
+    else if (name == "grid")
+    {
+        return Mode::grid;
+    }
     else if (name == "none")
     {
         return Mode::none;
@@ -36,13 +47,67 @@ Mode Str2Mode(std::string_view name)
     throw std::logic_error(fmt::format("mode {} cannot be resolved!", name));
 }
 
+SamplingMode Str2Sampling(std::string_view name)
+{
+    if (name == "plain")
+    {
+        return SamplingMode::plain;
+    }
+    else if (name == "antithetic")
+    {
+        return SamplingMode::antithetic;
+    }
+    else if (name == "stratified")
+    {
+        return SamplingMode::stratified;
+    }
+    else if (name == "sobol")
+    {
+        return SamplingMode::sobol;
+    }
+    throw std::logic_error(fmt::format("sampling mode {} cannot be resolved!", name));
+}
+
+struct Shard
+{
+    unsigned int index = 0;
+    unsigned int count = 1;
+};
+
+// "i/N" with 0 <= i < N
+auto Str2Shard(std::string_view name) -> Shard
+{
+    auto shard = Shard{};
+    const auto separator = name.find('/');
+    auto Parse = [name](std::string_view number, unsigned int& value)
+    {
+        const auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+        if (error != std::errc{} || end != number.data() + number.size())
+        {
+            throw std::logic_error(fmt::format("shard {} cannot be resolved, use i/N!", name));
+        }
+    };
+    if (separator == std::string_view::npos)
+    {
+        throw std::logic_error(fmt::format("shard {} cannot be resolved, use i/N!", name));
+    }
+    Parse(name.substr(0, separator), shard.index);
+    Parse(name.substr(separator + 1), shard.count);
+    if (shard.count == 0 || shard.index >= shard.count)
+    {
+        throw std::logic_error(fmt::format("shard {} does not exist!", name));
+    }
+    return shard;
+}
+
 auto main(int argc, char** argv) -> int
 {
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    Telemetry::SetThreadName("main");
 
     cxxopts::Options options("FineTimeNL", "Command flags for FineTime NeuLAND");
     options.add_options()("t,thread", "thread numbers", cxxopts::value<int>()->default_value("1"))(
-        "m, mode", "modes: pa, entryN, fix, none", cxxopts::value<std::string>()->default_value("pre"))(
+        "m, mode", "modes: pa, entryN, fix, grid, none", cxxopts::value<std::string>()->default_value("pre"))(
         "e, entryN", "number of full entryN", cxxopts::value<int>()->default_value("400"))(
         "e_min", "number of min full entryN", cxxopts::value<int>()->default_value("10"))(
         "e_max", "number of max full entryN", cxxopts::value<int>()->default_value("20"))(
@@ -50,6 +115,46 @@ auto main(int argc, char** argv) -> int
         "pb", "probability of the central bin in fix distribution", cxxopts::value<double>()->default_value("0.01"))(
         "pa", "probability of the previous bin in fix distribution", cxxopts::value<double>()->default_value("0."))(
         "pa_size", "probability of the previous bin in fix distribution", cxxopts::value<int>()->default_value("200"))(
+        "pb_max", "upper end of the pb axis in grid mode (pb is the lower end)",
+        cxxopts::value<double>()->default_value("0.1"))(
+        "pb_size", "number of pb values in grid mode", cxxopts::value<int>()->default_value("10"))(
+        "e_size", "number of entryN values in grid mode", cxxopts::value<int>()->default_value("10"))(
+        "sorted", "write rows sorted by the sweep parameter")(
+        "distributions",
+        "keep the histogram of every point of the sweep and write its bins to distributions.csv")(
+        "models",
+        "compare the stderr of every point with the error models err_pre, err_pre_approx, err_pre_base and "
+        "err_pre_scaled, written to models.csv")(
+        "fit_models", "fit the free parameters of the error models, see --models")(
+        "exact", "evaluate pa and entryN sweeps with the exact sums instead of sampling")(
+        "incremental",
+        "entryN sweep: reuse the samples of each entryN for the next one by adding a single entry (correlated points)")(
+        "flush_rows",
+        "stream csv rows to the file in chunks of this size (0: write at the end), not with --format bin",
+        cxxopts::value<int>()->default_value("0"))(
+        "format", "output format of the sweeps: csv, bin", cxxopts::value<std::string>()->default_value("csv"))(
+        "checkpoint", "record finished points in this file", cxxopts::value<std::string>()->default_value(""))(
+        "checkpoint_interval",
+        "seconds between writes of the checkpoint file",
+        cxxopts::value<int>()->default_value("60"))(
+        "resume", "skip the points already recorded in the checkpoint file")(
+        "stats", "print the hot path telemetry and write it to stats.json (stats.shard<i>of<N>.json with --shard)")(
+        "bins",
+        "number of bins: 3, 5 or 7, only in entryN mode, where the distribution over the bins is generated. Results "
+        "depend only on the sums before and after the central bin, which pa and pc already fix in the other modes",
+        cxxopts::value<int>()->default_value("3"))(
+        "precision",
+        "target relative error of mean and stderr, points stop sampling once it is reached (r_num is the limit)",
+        cxxopts::value<double>()->default_value("0"))(
+        "block", "samples between the checks of the precision target", cxxopts::value<int>()->default_value("1024"))(
+        "sampling",
+        "in-bin positions: plain, antithetic, stratified, sobol. mean_err is taken from the spread between replicates",
+        cxxopts::value<std::string>()->default_value("plain"))(
+        "conditioned",
+        "draw only samples with a nonzero central bin and weight them, no sample is skipped for small pb")(
+        "shard",
+        "run only shard i of N of the sweep, e.g. 2/8. Outputs are named <name>.shard<i>of<N>, see merge_shards",
+        cxxopts::value<std::string>()->default_value("0/1"))(
         "h,help", "Print usage");
 
     auto optresult = options.parse(argc, argv);
@@ -61,62 +166,311 @@ auto main(int argc, char** argv) -> int
 
     const auto prob_b = optresult["pb"].as<double>();
     const auto prob_a = optresult["pa"].as<double>();
-    auto fineTimeMC = FineTimeMC{};
+    const auto shard = Str2Shard(optresult["shard"].as<std::string>());
+    const auto flush_rows = optresult["flush_rows"].as<int>();
+    if (flush_rows < 0)
+    {
+        throw std::logic_error(fmt::format("flush_rows {} is negative, use 0 to write at the end!", flush_rows));
+    }
+    const auto format = optresult["format"].as<std::string>();
+    if (flush_rows > 0 && format == "bin")
+    {
+        throw std::logic_error("flush_rows only streams csv, columnar files are written at the end!");
+    }
+    auto Output_name = [&shard](std::string_view name, std::string_view extension)
+    {
+        return (shard.count == 1) ? fmt::format("{}.{}", name, extension)
+                                  : fmt::format("{}.shard{}of{}.{}", name, shard.index, shard.count, extension);
+    };
 
-    fineTimeMC.SetEntryN(optresult["entryN"].as<int>());
-    fineTimeMC.SetThreadsNum(optresult["thread"].as<int>());
-    fineTimeMC.SetRndNumber(optresult["r_num"].as<int>());
+    auto Configure = [&optresult, &shard](auto& fineTimeMC)
+    {
+        fineTimeMC.SetEntryN(optresult["entryN"].as<int>());
+        fineTimeMC.SetThreadsNum(optresult["thread"].as<int>());
+        const auto r_num = optresult["r_num"].as<int>();
+        if (r_num <= 0)
+        {
+            throw std::logic_error(fmt::format("r_num {} has to be positive!", r_num));
+        }
+        fineTimeMC.SetRndNumber(static_cast<unsigned int>(r_num));
+        fineTimeMC.SetSortedOutput(optresult.count("sorted") != 0);
+        fineTimeMC.SetWriteOnCompletion(true);
+        const auto block_size = static_cast<unsigned int>(optresult["block"].as<int>());
+        fineTimeMC.SetPrecisionTarget(
+            Precision_target{ .relative_error = optresult["precision"].as<double>(), .block_size = block_size });
+        fineTimeMC.SetSamplingMode(Str2Sampling(optresult["sampling"].as<std::string>()));
+        fineTimeMC.SetConditioned(optresult.count("conditioned") != 0);
+        if (optresult.count("exact") != 0)
+        {
+            fineTimeMC.SetEngineMode(EngineMode::exact);
+        }
+        else if (optresult.count("incremental") != 0)
+        {
+            fineTimeMC.SetEngineMode(EngineMode::incremental);
+        }
+        const auto checkpoint = optresult["checkpoint"].as<std::string>();
+        if (checkpoint.empty() && optresult.count("resume") != 0)
+        {
+            throw std::logic_error("resume needs the checkpoint file to resume from!");
+        }
+        // points with a histogram are not recorded, and a restored point would have none
+        if (!checkpoint.empty() &&
+            (optresult.count("distributions") != 0 || Str2Mode(optresult["mode"].as<std::string>()) == Mode::fix))
+        {
+            throw std::logic_error("checkpoint does not record histograms, it cannot be used with distributions or "
+                                   "in fix mode!");
+        }
+        // the shards would all write to the same checkpoint file
+        if (!checkpoint.empty() && shard.count > 1)
+        {
+            throw std::logic_error("checkpoint cannot be combined with shard!");
+        }
+        if (!checkpoint.empty())
+        {
+            fineTimeMC.SetCheckpoint(checkpoint,
+                                     optresult.count("resume") != 0,
+                                     std::chrono::seconds{ optresult["checkpoint_interval"].as<int>() });
+        }
+        if (shard.count > 1)
+        {
+            fineTimeMC.SetShard(shard.index, shard.count);
+        }
+    };
 
     // ----------------------------------------------------------------
     auto writer_entryN = CSVWriter{ [](auto* self, const Parallel_run_output& result)
-                                    { self->add_row(result.entryN, result.stat.mean, result.stat.err); },
+                                    {
+                                        self->add_row(result.entryN,
+                                                      result.stat.mean,
+                                                      result.stat.err,
+                                                      result.stat.mean_err,
+                                                      result.sampleN);
+                                    },
                                     CSVColumn<unsigned int>{ "entryN" },
                                     CSVColumn<float>{ "mean" },
-                                    CSVColumn<float>{ "stderr" } };
-    writer_entryN.SetFileName("entryN.csv");
+                                    CSVColumn<float>{ "stderr" },
+                                    CSVColumn<float>{ "mean_err" },
+                                    CSVColumn<unsigned int>{ "samples" } };
+    writer_entryN.SetFileName(Output_name("entryN", "csv"));
+    writer_entryN.SetFlushThreshold(static_cast<std::size_t>(flush_rows));
 
     // ----------------------------------------------------------------
     auto writer_pre = CSVWriter{ [](auto* self, const Parallel_run_output& result)
-                                 { self->add_row(result.pre_prob, result.stat.mean, result.stat.err); },
+                                 {
+                                     self->add_row(result.pre_prob,
+                                                   result.stat.mean,
+                                                   result.stat.err,
+                                                   result.stat.mean_err,
+                                                   result.sampleN);
+                                 },
                                  CSVColumn<double>{ "pa" },
                                  CSVColumn<float>{ "mean" },
-                                 CSVColumn<float>{ "stderr" } };
-    writer_pre.SetFileName("pa.csv");
+                                 CSVColumn<float>{ "stderr" },
+                                 CSVColumn<float>{ "mean_err" },
+                                 CSVColumn<unsigned int>{ "samples" } };
+    writer_pre.SetFileName(Output_name("pa", "csv"));
+    writer_pre.SetFlushThreshold(static_cast<std::size_t>(flush_rows));
+
+    // ----------------------------------------------------------------
+    auto columnar_entryN = ColumnarWriter{ [](auto* self, const Parallel_run_output& result)
+                                           {
+                                               self->add_row(result.entryN,
+                                                             result.stat.mean,
+                                                             result.stat.err,
+                                                             result.stat.mean_err,
+                                                             result.sampleN);
+                                           },
+                                           CSVColumn<unsigned int>{ "entryN" },
+                                           CSVColumn<float>{ "mean" },
+                                           CSVColumn<float>{ "stderr" },
+                                           CSVColumn<float>{ "mean_err" },
+                                           CSVColumn<unsigned int>{ "samples" } };
+    columnar_entryN.SetFileName(Output_name("entryN", "ftc"));
 
     // ----------------------------------------------------------------
-    auto drawer = HistDrawer{ "distri.png", [](auto* self, const auto& result) { self->Set(result); } };
+    auto columnar_pre = ColumnarWriter{ [](auto* self, const Parallel_run_output& result)
+                                        {
+                                            self->add_row(result.pre_prob,
+                                                          result.stat.mean,
+                                                          result.stat.err,
+                                                          result.stat.mean_err,
+                                                          result.sampleN);
+                                        },
+                                        CSVColumn<double>{ "pa" },
+                                        CSVColumn<float>{ "mean" },
+                                        CSVColumn<float>{ "stderr" },
+                                        CSVColumn<float>{ "mean_err" },
+                                        CSVColumn<unsigned int>{ "samples" } };
+    columnar_pre.SetFileName(Output_name("pa", "ftc"));
+
+    // ----------------------------------------------------------------
+    auto writer_grid = CSVWriter{ [](auto* self, const Parallel_run_output& result)
+                                  {
+                                      self->add_row(result.pre_prob,
+                                                    result.mid_prob,
+                                                    result.post_prob,
+                                                    result.entryN,
+                                                    result.stat.mean,
+                                                    result.stat.err,
+                                                    result.stat.mean_err,
+                                                    result.sampleN);
+                                  },
+                                  CSVColumn<float>{ "pa" },
+                                  CSVColumn<float>{ "pb" },
+                                  CSVColumn<float>{ "pc" },
+                                  CSVColumn<unsigned int>{ "entryN" },
+                                  CSVColumn<float>{ "mean" },
+                                  CSVColumn<float>{ "stderr" },
+                                  CSVColumn<float>{ "mean_err" },
+                                  CSVColumn<unsigned int>{ "samples" } };
+    writer_grid.SetFileName(Output_name("grid", "csv"));
+    writer_grid.SetFlushThreshold(static_cast<std::size_t>(flush_rows));
+
+    // ----------------------------------------------------------------
+    auto columnar_grid = ColumnarWriter{ [](auto* self, const Parallel_run_output& result)
+                                         {
+                                             self->add_row(result.pre_prob,
+                                                           result.mid_prob,
+                                                           result.post_prob,
+                                                           result.entryN,
+                                                           result.stat.mean,
+                                                           result.stat.err,
+                                                           result.stat.mean_err,
+                                                           result.sampleN);
+                                         },
+                                         CSVColumn<float>{ "pa" },
+                                         CSVColumn<float>{ "pb" },
+                                         CSVColumn<float>{ "pc" },
+                                         CSVColumn<unsigned int>{ "entryN" },
+                                         CSVColumn<float>{ "mean" },
+                                         CSVColumn<float>{ "stderr" },
+                                         CSVColumn<float>{ "mean_err" },
+                                         CSVColumn<unsigned int>{ "samples" } };
+    columnar_grid.SetFileName(Output_name("grid", "ftc"));
+
+    // ----------------------------------------------------------------
+#ifdef FINETIME_WITH_ROOT
+    auto drawer = HistDrawer{ "distri.png", [](auto* self, auto& result) { self->Set(result); } };
+#else
+    auto drawer = HistWriter{ "distri.csv", [](auto* self, auto& result) { self->Set(result); } };
+#endif
+    auto distributions =
+        HistCollector{ Output_name("distributions", "csv"), [](auto* self, auto& result) { self->Add(result); } };
+    auto models = ModelChecker{ Output_name("models", "csv"),
+                                [](auto* self, const auto& result) { self->Add(result); },
+                                Default_error_models() };
+    models.SetFitting(optresult.count("fit_models") != 0);
 
     //-----------------------------------------------------------------
-    switch (Str2Mode(optresult["mode"].as<std::string>()))
+    auto Run_mode = [&](auto& fineTimeMC, auto& pre_writer, auto& entryN_writer, auto& grid_writer)
     {
-        case Mode::pa:
+        switch (Str2Mode(optresult["mode"].as<std::string>()))
         {
-            fineTimeMC.RunFixedPbAllPa(prob_b, 0., 1., optresult["pa_size"].as<int>(), writer_pre);
-            break;
+            case Mode::pa:
+            {
+                fineTimeMC.RunFixedPbAllPa(prob_b, 0., 1., optresult["pa_size"].as<int>(), pre_writer);
+                break;
+            }
+            case Mode::entryN:
+            {
+                fineTimeMC.RunFixedPbAllEntryN(
+                    prob_b, optresult["e_min"].as<int>(), optresult["e_max"].as<int>(), entryN_writer);
+                break;
+            }
+            case Mode::fix:
+            {
+                fineTimeMC.RunWithAllFixed({ prob_a, prob_b, 1 - prob_a - prob_b }, drawer);
+                break;
+            }
+            case Mode::grid:
+            {
+                const auto pa_axis = Grid_axis{ 0., 1., static_cast<unsigned int>(optresult["pa_size"].as<int>()) };
+                const auto pb_axis = Grid_axis{ prob_b,
+                                                optresult["pb_max"].as<double>(),
+                                                static_cast<unsigned int>(optresult["pb_size"].as<int>()) };
+                const auto entryN_axis = Grid_axis{ static_cast<double>(optresult["e_min"].as<int>()),
+                                                    static_cast<double>(optresult["e_max"].as<int>()),
+                                                    static_cast<unsigned int>(optresult["e_size"].as<int>()) };
+                fineTimeMC.RunGrid(pa_axis, pb_axis, entryN_axis, grid_writer);
+                break;
+            }
+            case Mode::none:
+            {
+                break;
+            }
+        }
+    };
+
+    auto Run_simulation = [&](auto& fineTimeMC)
+    {
+        Configure(fineTimeMC);
+        if (optresult.count("distributions") != 0)
+        {
+            fineTimeMC.SetInserterMode(InserterMode::histogram);
+            fineTimeMC.AddObserver(distributions);
+        }
+        if (optresult.count("models") != 0)
+        {
+            fineTimeMC.AddObserver(models);
+        }
+        if (format == "bin")
+        {
+            Run_mode(fineTimeMC, columnar_pre, columnar_entryN, columnar_grid);
         }
-        case Mode::entryN:
+        else if (format == "csv")
+        {
+            Run_mode(fineTimeMC, writer_pre, writer_entryN, writer_grid);
+        }
+        else
+        {
+            throw std::logic_error(fmt::format("format {} cannot be resolved!", format));
+        }
+
+        // ----------------------------------------------------------------
+        fineTimeMC.Wait();
+        fineTimeMC.Write();
+    };
+
+    const auto bins = optresult["bins"].as<int>();
+    if (bins != 3 && Str2Mode(optresult["mode"].as<std::string>()) != Mode::entryN)
+    {
+        throw std::logic_error(fmt::format("{} bins only change the generated distributions of the entryN mode, other "
+                                           "modes give the results of 3 bins!",
+                                           bins));
+    }
+    switch (bins)
+    {
+        case 3:
         {
-            fineTimeMC.RunFixedPbAllEntryN(
-                prob_b, optresult["e_min"].as<int>(), optresult["e_max"].as<int>(), writer_entryN);
+            auto fineTimeMC = FineTimeMC<3>{};
+            Run_simulation(fineTimeMC);
             break;
         }
-        case Mode::fix:
+        case 5:
         {
-            fineTimeMC.RunWithAllFixed({ prob_a, prob_b, 1 - prob_a - prob_b }, drawer);
+            auto fineTimeMC = FineTimeMC<5>{};
+            Run_simulation(fineTimeMC);
             break;
         }
-        case Mode::none:
+        case 7:
         {
+            auto fineTimeMC = FineTimeMC<7>{};
+            Run_simulation(fineTimeMC);
             break;
         }
+        default:
+        {
+            throw std::logic_error(fmt::format("{} bins are not supported, choose 3, 5 or 7!", bins));
+        }
     }
 
-    // ----------------------------------------------------------------
-    fineTimeMC.Wait();
-    fineTimeMC.Write();
-
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
     std::cout << "Execution time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
               << "[ms]" << std::endl;
+    if (optresult.count("stats") != 0)
+    {
+        Telemetry::Print(std::cout, end - begin);
+        Telemetry::WriteJson(Output_name("stats", "json"), end - begin);
+    }
     return 0;
 }
@@ -0,0 +1,153 @@
+#include "ColumnarWriter.hpp"
+#include <algorithm>
+#include <cxxopts.hpp>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Combines the outputs of a sweep run with main --shard i/N into the table of the whole sweep. The shards write their
+// rows sorted and cover contiguous blocks of the sweep, so the merged file is the shard files concatenated in shard
+// order, identical to the output of an unsharded run with --sorted. Works for csv and columnar (.ftc) files.
+
+struct Shard_file
+{
+    std::string filename;
+    unsigned int index = 0;
+    unsigned int count = 0;
+};
+
+// inputs named <name>.shard<i>of<N>.<extension> by main, all N of them are required
+auto Order_shards(const std::vector<std::string>& filenames) -> std::vector<Shard_file>
+{
+    const auto pattern = std::regex{ R"(\.shard(\d+)of(\d+)\.[^.]+$)" };
+    auto shards = std::vector<Shard_file>{};
+    for (const auto& filename : filenames)
+    {
+        auto match = std::smatch{};
+        if (!std::regex_search(filename, match, pattern))
+        {
+            throw std::logic_error(fmt::format("{} is not named like a shard output <name>.shard<i>of<N>!", filename));
+        }
+        shards.push_back(Shard_file{ .filename = filename,
+                                     .index = static_cast<unsigned int>(std::stoul(match[1].str())),
+                                     .count = static_cast<unsigned int>(std::stoul(match[2].str())) });
+    }
+    std::ranges::sort(shards, {}, &Shard_file::index);
+    for (std::size_t position{}; position < shards.size(); ++position)
+    {
+        const auto& shard = shards[position];
+        if (shard.index != position || shard.count != shards.size())
+        {
+            throw std::logic_error(fmt::format(
+                "shard files do not cover 0 .. {} exactly once, got {}!", shard.count - 1, shard.filename));
+        }
+    }
+    return shards;
+}
+
+auto Is_columnar(const std::string& filename) -> bool
+{
+    auto istream = std::ifstream{ filename, std::ios_base::binary };
+    auto magic = std::string(COLUMNAR_MAGIC.size(), '\0');
+    istream.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+    return istream && magic == COLUMNAR_MAGIC;
+}
+
+void Merge_csv(const std::vector<Shard_file>& shards, std::ofstream& ostream)
+{
+    auto header = std::string{};
+    for (const auto& shard : shards)
+    {
+        auto istream = std::ifstream{ shard.filename };
+        if (!istream)
+        {
+            throw std::runtime_error(fmt::format("cannot open {}!", shard.filename));
+        }
+        auto line = std::string{};
+        std::getline(istream, line);
+        if (shard.index == 0)
+        {
+            header = line;
+            ostream << header << "\n";
+        }
+        else if (line != header)
+        {
+            throw std::logic_error(fmt::format("{} has a different header!", shard.filename));
+        }
+        while (std::getline(istream, line))
+        {
+            ostream << line << "\n";
+        }
+    }
+}
+
+void Merge_columnar(const std::vector<Shard_file>& shards, std::ofstream& ostream)
+{
+    auto files = std::vector<std::unique_ptr<ColumnarFile>>{};
+    for (const auto& shard : shards)
+    {
+        files.push_back(std::make_unique<ColumnarFile>(shard.filename));
+    }
+    const auto& columns = files.front()->GetColumns();
+    auto rows_num = uint64_t{};
+    auto data = std::vector<std::string>(columns.size());
+    for (std::size_t index{}; index < files.size(); ++index)
+    {
+        const auto& file = *files[index];
+        const auto& file_columns = file.GetColumns();
+        const auto is_same_layout = std::ranges::equal(
+            file_columns,
+            columns,
+            [](const auto& left, const auto& right) { return left.name == right.name && left.dtype == right.dtype; });
+        if (!is_same_layout)
+        {
+            throw std::logic_error(fmt::format("{} has different columns!", shards[index].filename));
+        }
+        rows_num += file.GetRowsNum();
+        for (std::size_t column{}; column < columns.size(); ++column)
+        {
+            data[column].append(file.GetColumnBytes(file_columns[column]));
+        }
+    }
+    auto blocks = std::vector<Column_block>{};
+    for (std::size_t column{}; column < columns.size(); ++column)
+    {
+        blocks.push_back(
+            Column_block{ .name = columns[column].name, .dtype = columns[column].dtype, .data = data[column] });
+    }
+    Write_columnar(ostream, rows_num, blocks);
+}
+
+auto main(int argc, char** argv) -> int
+{
+    cxxopts::Options options("merge_shards", "Merges the outputs of a sweep run with --shard i/N");
+    options.add_options()("o, output", "merged file", cxxopts::value<std::string>())(
+        "inputs", "shard outputs, in any order", cxxopts::value<std::vector<std::string>>())("h,help", "Print usage");
+    options.parse_positional({ "inputs" });
+    options.positional_help("<shard files>");
+
+    auto optresult = options.parse(argc, argv);
+    if (optresult.count("help") != 0 || optresult.count("output") == 0 || optresult.count("inputs") == 0)
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    const auto shards = Order_shards(optresult["inputs"].as<std::vector<std::string>>());
+    const auto output = optresult["output"].as<std::string>();
+    const auto is_columnar = Is_columnar(shards.front().filename);
+    auto ostream = std::ofstream{ output, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary };
+    if (is_columnar)
+    {
+        Merge_columnar(shards, ostream);
+    }
+    else
+    {
+        Merge_csv(shards, ostream);
+    }
+    std::cout << fmt::format("merged {} shards into {}\n", shards.size(), output);
+    return 0;
+}
@@ -1,10 +1,25 @@
 #pragma once
 
+#include <array>
+#include <cmath>
 #include <concepts>
+#include <cstdint>
 #include <future>
 #include <iostream>
+#include <memory>
+
+class Histogram;
+class HistogramPool;
+
+// returns a histogram to the pool it was acquired from, see HistogramPool
+struct HistogramRecycler
+{
+    std::shared_ptr<HistogramPool> pool;
+    void operator()(Histogram* histogram) const;
+};
+
+using HistogramHandle = std::unique_ptr<Histogram, HistogramRecycler>;
 
-class TH1;
 template <int size1, std::size_t... sizes>
 concept Equal = ((size1 == sizes) && ...);
 
@@ -28,26 +43,115 @@ struct MeanError
 {
     float mean = 0.;
     float err = 0.;
+    float mean_err = 0.; // Monte Carlo standard error of mean, 0 for the exact engine
+};
+
+// How the in-bin positions are drawn. Apart from plain, the positions of the samples inside one replicate (see
+// GetReplicateSize) are correlated to cancel their fluctuations, and the errors come from the spread between the
+// replicates.
+enum class SamplingMode
+{
+    plain,
+    antithetic, // pairs at u and 1 - u
+    stratified, // one position in each of the equal strata of the bin
+    sobol       // van der Corput points, the first Sobol dimension, with Owen's nested scrambling
+};
+
+// Sequential stopping rule: a point stops sampling after the first block of block_size samples at which the
+// relative standard errors of both the mean and the standard deviation are at most relative_error, but not before
+// min_blocks blocks. rndNum stays the upper limit. 0 samples every point rndNum times.
+struct Precision_target
+{
+    double relative_error = 0.;
+    unsigned int block_size = 1024;
+    unsigned int min_blocks = 2;
 };
 
 struct Parallel_run_input
 {
     double pb = 0.1;
     double pbMax = 1.;
-    double pa_begin = 0.;
-    double pa_num = 0.;
-    double pa_step = 0.;
+    uint64_t stream = 0;       // random stream of the current parameter point
+    uint64_t first_sample = 0; // nonzero for the later shards of a point split over several tasks
+    std::size_t writer_index = 0;
+    std::size_t task = 0; // position of the task computing the point in its sweep, see FineTimeMC::Schedule
+    unsigned int worker = 0;
     unsigned int entryN = 100;
     unsigned int rndNum = 1000;
-    unsigned int entryNloopSize = 20;
+    Precision_target precision;
+    SamplingMode sampling = SamplingMode::plain;
+    bool is_conditioned = false; // draws with a nonzero central bin only
 };
 
+// num points from min in steps of (max - min) / num, max itself excluded like in the pa sweep
+struct Grid_axis
+{
+    double min = 0.;
+    double max = 1.;
+    unsigned int num = 1;
+
+    [[nodiscard]] auto GetValue(unsigned int index) const -> double
+    {
+        return min + index * (max - min) / num;
+    }
+
+    [[nodiscard]] auto GetRoundedValue(unsigned int index) const -> unsigned int
+    {
+        return static_cast<unsigned int>(std::lround(GetValue(index)));
+    }
+};
+
+// probabilities of all bins before the central one, of the central bin and of all bins after it
+template <std::size_t BinSize>
+constexpr auto Aggregate(const std::array<double, BinSize>& distribution) -> std::array<double, 3>
+{
+    constexpr auto center = BinSize / 2;
+    auto aggregated = std::array<double, 3>{ 0., distribution[center], 0. };
+    for (std::size_t bin{}; bin < center; ++bin)
+    {
+        aggregated.front() += distribution[bin];
+        aggregated.back() += distribution[center + 1 + bin];
+    }
+    return aggregated;
+}
+
+// spreads aggregated probabilities evenly over the bins on each side of the central one
+template <std::size_t BinSize>
+constexpr auto Expand(const std::array<double, 3>& aggregated) -> std::array<double, BinSize>
+{
+    constexpr auto center = BinSize / 2;
+    auto distribution = std::array<double, BinSize>{};
+    distribution[center] = aggregated[1];
+    for (std::size_t bin{}; bin < center; ++bin)
+    {
+        distribution[bin] = aggregated.front() / center;
+        distribution[center + 1 + bin] = aggregated.back() / center;
+    }
+    return distribution;
+}
+
+// Pre, mid and post probabilities are aggregated over the bins on each side, see Aggregate. The result owns its
+// histogram, a write strategy may move it out to keep it.
 struct Parallel_run_output
 {
     unsigned int entryN;
+    unsigned int sampleN = 0; // samples drawn, 0 for the exact engine
+    unsigned int filledN = 0; // samples with a nonzero central bin, the ones the moments in stat are taken from
     MeanError stat{};
     float pre_prob = 0.;
     float mid_prob = 0.;
     float post_prob = 0.;
-    TH1* histogram;
+    HistogramHandle histogram; // nullptr if the inserter runs in statistics mode
+
+    [[nodiscard]] auto CopyWithoutHistogram() const -> Parallel_run_output
+    {
+        return Parallel_run_output{ .entryN = entryN,
+                                    .sampleN = sampleN,
+                                    .filledN = filledN,
+                                    .stat = stat,
+                                    .pre_prob = pre_prob,
+                                    .mid_prob = mid_prob,
+                                    .post_prob = post_prob,
+                                    .histogram = nullptr };
+    }
 };
@@ -0,0 +1,169 @@
+#include "Checkpoint.hpp"
+#include "CounterRNG.hpp"
+#include <cmath>
+#include <filesystem>
+#include <fmt/core.h>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void Check(bool is_passed, std::string_view what)
+    {
+        if (!is_passed)
+        {
+            fmt::print("FAILED: {}\n", what);
+            ++failures;
+        }
+    }
+
+    struct Point
+    {
+        std::size_t writer_index = 0;
+        uint64_t stream = 0;
+        Parallel_run_output output;
+    };
+
+    auto Make_points() -> std::vector<Point>
+    {
+        auto points = std::vector<Point>{};
+        points.push_back({ 0,
+                           StreamKey(StreamTag::pa, 0),
+                           { .entryN = 40,
+                             .sampleN = 1000,
+                             .filledN = 873,
+                             .stat = { 0.1F, 1.F / 3.F, 2.3e-3F },
+                             .pre_prob = 0.F,
+                             .mid_prob = 0.3F,
+                             .post_prob = 0.7F,
+                             .histogram = nullptr } });
+        points.push_back({ 1,
+                           StreamKey(StreamTag::grid, 123456789),
+                           { .entryN = 1,
+                             .sampleN = 0,
+                             .filledN = 0,
+                             .stat = { std::numeric_limits<float>::denorm_min(), 0.F, 0.F },
+                             .pre_prob = 0.995F,
+                             .mid_prob = 0.005F,
+                             .post_prob = 0.F,
+                             .histogram = nullptr } });
+        points.push_back({ 2,
+                           std::numeric_limits<uint64_t>::max(),
+                           { .entryN = 4000000000U,
+                             .sampleN = 4000000000U,
+                             .filledN = 1,
+                             .stat = { std::numeric_limits<float>::max(), 1e-30F, 7.F },
+                             .pre_prob = 1.F / 7.F,
+                             .mid_prob = 2.F / 7.F,
+                             .post_prob = 4.F / 7.F,
+                             .histogram = nullptr } });
+        return points;
+    }
+
+    auto Is_same(const Parallel_run_output& left, const Parallel_run_output& right) -> bool
+    {
+        return left.entryN == right.entryN && left.sampleN == right.sampleN && left.filledN == right.filledN &&
+               left.stat.mean == right.stat.mean && left.stat.err == right.stat.err &&
+               left.stat.mean_err == right.stat.mean_err && left.pre_prob == right.pre_prob &&
+               left.mid_prob == right.mid_prob && left.post_prob == right.post_prob;
+    }
+
+    auto Throws_logic_error(auto&& Action) -> bool
+    {
+        try
+        {
+            Action();
+        }
+        catch (const std::logic_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+} // namespace
+
+auto main() -> int
+{
+    const auto filename = (std::filesystem::temp_directory_path() / "finetime_checkpoint_test.txt").string();
+    const auto signature = Checkpoint::Signature{ .seed = 42,
+                                                  .entryN = 40,
+                                                  .rndNum = 1000,
+                                                  .engine_mode = 0,
+                                                  .precision = 0.1,
+                                                  .block_size = 1024,
+                                                  .bins = 3,
+                                                  .sampling = 1,
+                                                  .is_conditioned = 1 };
+    const auto points = Make_points();
+    {
+        auto checkpoint = Checkpoint{ filename, signature, false };
+        checkpoint.SetFlushInterval(std::chrono::seconds{ 0 });
+        for (const auto& point : points)
+        {
+            checkpoint.Add(point.writer_index, point.stream, point.output);
+        }
+    }
+
+    // a line cut off by a crash and a broken line are skipped
+    {
+        auto file = std::ofstream{ filename, std::ios_base::out | std::ios_base::app };
+        file << "3 17 not a point\n";
+        file << "4 18 40 1000 1000 0x1p+0";
+    }
+
+    {
+        auto checkpoint = Checkpoint{ filename, signature, true };
+        for (const auto& point : points)
+        {
+            const auto* restored = checkpoint.Find(point.writer_index, point.stream);
+            Check(restored != nullptr && Is_same(*restored, point.output),
+                  fmt::format("round trip of writer {} stream {}", point.writer_index, point.stream));
+        }
+        Check(checkpoint.Find(0, StreamKey(StreamTag::pa, 1)) == nullptr, "unknown stream");
+        Check(checkpoint.Find(1, StreamKey(StreamTag::pa, 0)) == nullptr, "stream of another writer");
+        Check(checkpoint.Find(3, 17) == nullptr, "broken line");
+        Check(checkpoint.Find(4, 18) == nullptr, "cut off line");
+    }
+
+    // resuming rewrote the file with the valid points only, so it can be resumed again
+    {
+        auto checkpoint = Checkpoint{ filename, signature, true };
+        Check(checkpoint.Find(2, points.back().stream) != nullptr, "second resume");
+    }
+
+    for (const auto& [name, Change] : std::vector<std::pair<std::string, void (*)(Checkpoint::Signature&)>>{
+             { "seed", [](Checkpoint::Signature& changed) { ++changed.seed; } },
+             { "precision", [](Checkpoint::Signature& changed) { changed.precision = std::nextafter(0.1, 1.); } },
+             { "sampling", [](Checkpoint::Signature& changed) { changed.sampling = 0; } },
+             { "conditioned", [](Checkpoint::Signature& changed) { changed.is_conditioned = 0; } } })
+    {
+        auto changed = signature;
+        Change(changed);
+        Check(Throws_logic_error([&]() { auto checkpoint = Checkpoint{ filename, changed, true }; }),
+              fmt::format("resume with a different {}", name));
+    }
+
+    // without resuming the file starts over
+    {
+        auto checkpoint = Checkpoint{ filename, signature, false };
+        Check(checkpoint.Find(0, points.front().stream) == nullptr, "overwritten checkpoint");
+    }
+
+    {
+        auto file = std::ofstream{ filename, std::ios_base::out | std::ios_base::trunc };
+        file << "entryN, mean\n";
+    }
+    Check(Throws_logic_error([&]() { auto checkpoint = Checkpoint{ filename, signature, true }; }),
+          "resume from a file that is no checkpoint");
+
+    std::filesystem::remove(filename);
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
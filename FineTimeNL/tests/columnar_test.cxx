@@ -0,0 +1,113 @@
+#include "ColumnarWriter.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fmt/core.h>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    int failures = 0;
+
+    void Check(bool is_passed, std::string_view what)
+    {
+        if (!is_passed)
+        {
+            fmt::print("FAILED: {}\n", what);
+            ++failures;
+        }
+    }
+
+    auto Throws_runtime_error(const std::string& filename) -> bool
+    {
+        try
+        {
+            auto file = ColumnarFile{ filename };
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void Write_file(const std::string& filename, const std::string& content)
+    {
+        auto ostream = std::ofstream{ filename, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary };
+        ostream << content;
+    }
+
+    // position of the first byte of value in the header
+    template <typename Type>
+    auto Find_value(const std::string& content, Type value) -> std::size_t
+    {
+        return content.find(std::string_view{ reinterpret_cast<const char*>(&value), sizeof(value) });
+    }
+
+    template <typename Type>
+    auto Replace_value(std::string content, std::size_t position, Type value) -> std::string
+    {
+        std::memcpy(content.data() + position, &value, sizeof(value));
+        return content;
+    }
+} // namespace
+
+auto main() -> int
+{
+    const auto filename = (std::filesystem::temp_directory_path() / "finetime_columnar_test.ftc").string();
+    const auto means = std::vector<double>{ 1.5, 2.5, 3.5 };
+    const auto samples = std::vector<unsigned int>{ 10, 20, 30 };
+    const auto blocks = std::vector<Column_block>{
+        { "mean", "<f8", { reinterpret_cast<const char*>(means.data()), means.size() * sizeof(double) } },
+        { "samples", "<u4", { reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(unsigned int) } }
+    };
+    auto ostream = std::ostringstream{};
+    Write_columnar(ostream, 3, blocks);
+    const auto content = ostream.str();
+
+    Write_file(filename, content);
+    {
+        auto file = ColumnarFile{ filename };
+        const auto read_means = file.GetColumn<double>("mean");
+        const auto read_samples = file.GetColumn<unsigned int>("samples");
+        Check(file.GetRowsNum() == 3, "rows");
+        Check(std::ranges::equal(read_means, means), "double column");
+        Check(std::ranges::equal(read_samples, samples), "unsigned column");
+    }
+
+    // an empty table keeps its header and has empty columns
+    auto empty_stream = std::ostringstream{};
+    Write_columnar(empty_stream, 0, std::vector<Column_block>{ { "mean", "<f8", {} } });
+    Write_file(filename, empty_stream.str());
+    {
+        auto file = ColumnarFile{ filename };
+        Check(file.GetRowsNum() == 0 && file.GetColumn<double>("mean").empty(), "empty table");
+    }
+
+    // the row count sits right after the magic, version and page size
+    const auto rows_position = COLUMNAR_MAGIC.size() + 2 * sizeof(uint32_t);
+    Write_file(filename, Replace_value(content, rows_position, uint64_t{ 4 }));
+    Check(Throws_runtime_error(filename), "more rows than the column blocks hold");
+    Write_file(filename, Replace_value(content, rows_position, uint64_t{ 1 } << 62U));
+    Check(Throws_runtime_error(filename), "row count overflowing the block size");
+
+    // offset and size of the first column follow its dtype
+    const auto offset_position = content.find("<f8") + 4;
+    Write_file(filename, Replace_value(content, offset_position, ~uint64_t{}));
+    Check(Throws_runtime_error(filename), "offset beyond the file");
+    const auto size_position = offset_position + sizeof(uint64_t);
+    Check(Find_value(content, uint64_t{ 3 * sizeof(double) }) == size_position, "size position");
+    Write_file(filename, Replace_value(content, size_position, ~uint64_t{} - 100));
+    Check(Throws_runtime_error(filename), "size overflowing the offset");
+
+    Write_file(filename, Replace_value(content, content.find("<u4") + 1, 'x'));
+    Check(Throws_runtime_error(filename), "unknown dtype");
+
+    std::filesystem::remove(filename);
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
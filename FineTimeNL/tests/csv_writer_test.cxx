@@ -0,0 +1,67 @@
+#include "Sinker.hpp"
+#include <filesystem>
+#include <fmt/core.h>
+#include <sstream>
+
+namespace
+{
+    int failures = 0;
+
+    void Check(bool is_passed, std::string_view what)
+    {
+        if (!is_passed)
+        {
+            fmt::print("FAILED: {}\n", what);
+            ++failures;
+        }
+    }
+
+    auto Read_file(const std::string& filename) -> std::string
+    {
+        auto istream = std::ifstream{ filename };
+        auto content = std::stringstream{};
+        content << istream.rdbuf();
+        return content.str();
+    }
+
+    // two sweeps on the same writer, each followed by write() like with SetWriteOnCompletion
+    auto Write_twice(const std::string& filename, std::size_t flush_rows) -> std::string
+    {
+        auto writer = CSVWriter{ [](auto* self, const std::pair<int, double>& row)
+                                 { self->add_row(row.first, row.second); },
+                                 CSVColumn<int>{ "index" },
+                                 CSVColumn<double>{ "value" } };
+        writer.SetFileName(filename);
+        writer.SetFlushThreshold(flush_rows);
+        for (int index{}; index < 5; ++index)
+        {
+            auto row = std::pair{ index, 0.5 * index };
+            writer(row);
+        }
+        writer.write();
+        for (int index = 5; index < 8; ++index)
+        {
+            auto row = std::pair{ index, 0.5 * index };
+            writer(row);
+        }
+        writer.write();
+        return Read_file(filename);
+    }
+} // namespace
+
+auto main() -> int
+{
+    const auto filename = (std::filesystem::temp_directory_path() / "finetime_csv_writer_test.csv").string();
+    const auto expected = std::string{ "index, value\n0, 0\n1, 0.5\n2, 1\n3, 1.5\n4, 2\n5, 2.5\n6, 3\n7, 3.5\n" };
+    Check(Write_twice(filename, 0) == expected, "rows kept in memory");
+    Check(Write_twice(filename, 2) == expected, "rows streamed in chunks of 2");
+    Check(Write_twice(filename, 1000) == expected, "rows streamed in one chunk per sweep");
+
+    std::filesystem::remove(filename);
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
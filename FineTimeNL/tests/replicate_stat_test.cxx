@@ -0,0 +1,138 @@
+#include "CounterRNG.hpp"
+#include "RunningStat.hpp"
+#include <cmath>
+#include <fmt/core.h>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void Check(bool is_passed, std::string_view what)
+    {
+        if (!is_passed)
+        {
+            fmt::print("FAILED: {}\n", what);
+            ++failures;
+        }
+    }
+
+    void Check_close(double value, double expected, double tolerance, std::string_view what)
+    {
+        Check(std::abs(value - expected) <= tolerance * std::abs(expected),
+              fmt::format("{}: {} instead of {}", what, value, expected));
+    }
+
+    // count, sum and sum of squares of replicates with up to 16 values, some of them empty
+    auto Make_replicates(std::size_t replicates_num) -> std::vector<std::array<double, 3>>
+    {
+        constexpr std::size_t replicate_size = 16;
+        auto engine = CounterEngine{ 3, 1 };
+        auto replicates = std::vector<std::array<double, 3>>{};
+        for (std::size_t index{}; index < replicates_num; ++index)
+        {
+            auto replicate = std::array<double, 3>{};
+            for (std::size_t value_index{}; value_index < replicate_size; ++value_index)
+            {
+                const auto value = 10. * engine.Rndm();
+                // about a third of the values are missing, like samples with an empty central bin
+                if (engine.Rndm() < 1. / 3.)
+                {
+                    continue;
+                }
+                replicate[0] += 1.;
+                replicate[1] += value;
+                replicate[2] += value * value;
+            }
+            replicates.push_back(replicate);
+        }
+        return replicates;
+    }
+
+    void Check_same(const ReplicateStat& stat, const ReplicateStat& expected, std::string_view name)
+    {
+        constexpr double tolerance = 1e-10;
+        Check(stat.GetReplicatesNum() == expected.GetReplicatesNum(), fmt::format("{} replicates", name));
+        Check_close(stat.GetMean(), expected.GetMean(), tolerance, fmt::format("{} mean", name));
+        Check_close(stat.GetVariance(), expected.GetVariance(), tolerance, fmt::format("{} variance", name));
+        Check_close(stat.GetMeanError(), expected.GetMeanError(), tolerance, fmt::format("{} mean error", name));
+        Check_close(
+            stat.GetVarianceError(), expected.GetVarianceError(), tolerance, fmt::format("{} variance error", name));
+    }
+} // namespace
+
+auto main() -> int
+{
+    constexpr std::size_t replicates_num = 2000;
+    const auto replicates = Make_replicates(replicates_num);
+    auto whole = ReplicateStat{};
+    for (const auto& [count, sum, sum2] : replicates)
+    {
+        whole.Push(count, sum, sum2);
+    }
+
+    // the ratio estimators and the error of the mean from a two-pass evaluation
+    auto totals = std::array<double, 3>{};
+    for (const auto& replicate : replicates)
+    {
+        for (std::size_t index{}; index < 3; ++index)
+        {
+            totals[index] += replicate[index];
+        }
+    }
+    const auto mean = totals[1] / totals[0];
+    const auto variance = totals[2] / totals[0] - mean * mean;
+    const auto replicates_size = static_cast<double>(replicates_num);
+    auto influence_mean = 0.;
+    for (const auto& replicate : replicates)
+    {
+        influence_mean += (replicate[1] - mean * replicate[0]) / replicates_size;
+    }
+    auto influence_variance = 0.;
+    for (const auto& replicate : replicates)
+    {
+        const auto influence = replicate[1] - mean * replicate[0] - influence_mean;
+        influence_variance += influence * influence / (replicates_size - 1.);
+    }
+    const auto mean_error = std::sqrt(influence_variance / replicates_size) / (totals[0] / replicates_size);
+    Check_close(whole.GetMean(), mean, 1e-12, "mean");
+    Check_close(whole.GetVariance(), variance, 1e-10, "variance");
+    Check_close(whole.GetMeanError(), mean_error, 1e-8, "mean error");
+
+    // uniform values on [0, 10) that are independent, so the replicates only add up their fluctuations
+    const auto values_num = totals[0];
+    Check_close(whole.GetMeanError(), std::sqrt(variance / values_num), 0.1, "mean error of independent values");
+    Check_close(whole.GetVariance(), 100. / 12., 0.05, "variance of the uniform values");
+
+    // parts of different sizes, one of them empty and one with a single replicate, merged in order
+    const auto part_ends = std::array<std::size_t, 5>{ 700, 700, 701, 1500, replicates_num };
+    auto merged = ReplicateStat{};
+    auto begin = std::size_t{};
+    for (const auto end : part_ends)
+    {
+        auto part = ReplicateStat{};
+        for (auto index = begin; index < end; ++index)
+        {
+            part.Push(replicates[index][0], replicates[index][1], replicates[index][2]);
+        }
+        merged.Merge(part);
+        begin = end;
+    }
+    Check_same(merged, whole, "merged parts");
+
+    // merging into an empty statistic and merging an empty one change nothing
+    auto copy = ReplicateStat{};
+    copy.Merge(whole);
+    copy.Merge(ReplicateStat{});
+    Check_same(copy, whole, "merged into empty");
+
+    whole.Reset();
+    Check(whole.GetReplicatesNum() == 0 && whole.GetMean() == 0. && whole.GetMeanError() == 0., "reset");
+
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "BinomialSampler.hpp"
+#include <cmath>
+#include <fmt/core.h>
+
+namespace
+{
+    constexpr unsigned int draws_num = 200000;
+    constexpr double sigma_limit = 5.;
+    int failures = 0;
+
+    void Check(bool is_passed, std::string_view what)
+    {
+        if (!is_passed)
+        {
+            fmt::print("FAILED: {}\n", what);
+            ++failures;
+        }
+    }
+
+    // mean and variance of the draws against the expected ones, within sigma_limit standard errors
+    void Check_moments(std::string_view name, auto&& Draw, double mean, double variance)
+    {
+        auto engine = CounterEngine{ 1, 1 };
+        auto sum = 0.;
+        auto sum2 = 0.;
+        for (unsigned int sample{}; sample < draws_num; ++sample)
+        {
+            engine.SetSample(sample);
+            const auto value = static_cast<double>(Draw(engine));
+            sum += value;
+            sum2 += value * value;
+        }
+        const auto draws = static_cast<double>(draws_num);
+        const auto sample_mean = sum / draws;
+        const auto sample_variance = sum2 / draws - sample_mean * sample_mean;
+        // the standard error of the variance is taken as for a normal distribution
+        const auto mean_error = std::sqrt(variance / draws);
+        const auto variance_error = variance * std::sqrt(2. / draws);
+        fmt::print("{}: mean {} ({}), variance {} ({})\n", name, sample_mean, mean, sample_variance, variance);
+        Check(std::abs(sample_mean - mean) < sigma_limit * mean_error, fmt::format("{} mean", name));
+        Check(std::abs(sample_variance - variance) < sigma_limit * variance_error, fmt::format("{} variance", name));
+    }
+
+    void Check_binomial(unsigned int trials, double prob, bool is_tabulated)
+    {
+        auto sampler = BinomialSampler{};
+        sampler.Set(trials, prob);
+        if (is_tabulated)
+        {
+            sampler.PrepareTable();
+        }
+        const auto mean = trials * prob;
+        const auto variance = mean * (1. - prob);
+        const auto name = fmt::format("B({}, {}){}", trials, prob, is_tabulated ? " table" : "");
+        Check_moments(name, [&sampler](CounterEngine& engine) { return sampler(engine); }, mean, variance);
+
+        // conditioned on a nonzero value
+        const auto positive_prob = 1. - std::pow(1. - prob, trials);
+        const auto positive_mean = mean / positive_prob;
+        const auto positive_variance = (variance + mean * mean) / positive_prob - positive_mean * positive_mean;
+        Check(std::abs(sampler.GetPositiveProb() - positive_prob) < 1e-12, fmt::format("{} positive prob", name));
+        Check_moments(fmt::format("{} positive", name),
+                      [&sampler](CounterEngine& engine) { return sampler.DrawPositive(engine); },
+                      positive_mean,
+                      positive_variance);
+    }
+
+    // the table only changes the rounding of the partial sums, which almost never moves a draw
+    void Check_table_agreement(unsigned int trials, double prob)
+    {
+        auto plain = BinomialSampler{};
+        plain.Set(trials, prob);
+        auto tabulated = plain;
+        tabulated.PrepareTable();
+        auto engine = CounterEngine{ 1, 2 };
+        auto differences = 0U;
+        for (unsigned int sample{}; sample < draws_num; ++sample)
+        {
+            engine.SetSample(sample);
+            const auto plain_value = plain(engine);
+            engine.SetSample(sample);
+            differences += (tabulated(engine) != plain_value) ? 1U : 0U;
+            engine.SetSample(sample);
+            const auto positive_value = plain.DrawPositive(engine);
+            engine.SetSample(sample);
+            differences += (tabulated.DrawPositive(engine) != positive_value) ? 1U : 0U;
+        }
+        Check(differences <= 2, fmt::format("B({}, {}) table differs in {} draws", trials, prob, differences));
+    }
+
+    void Check_trinomial()
+    {
+        constexpr unsigned int entryN = 40;
+        const auto distribution = std::array{ 0.3, 0.05, 0.65 };
+        auto sampler = TrinomialSampler{};
+        sampler.Set(entryN, distribution);
+        auto entries = std::array<unsigned int, 3>{};
+        for (std::size_t bin{}; bin < distribution.size(); ++bin)
+        {
+            const auto mean = entryN * distribution[bin];
+            Check_moments(fmt::format("trinomial bin {}", bin),
+                          [&](CounterEngine& engine)
+                          {
+                              sampler(engine, entries);
+                              Check(entries[0] + entries[1] + entries[2] == entryN, "trinomial entries sum");
+                              return entries[bin];
+                          },
+                          mean,
+                          mean * (1. - distribution[bin]));
+        }
+    }
+} // namespace
+
+auto main() -> int
+{
+    // sequential inversion, with and without the table
+    Check_binomial(20, 0.1, false);
+    Check_binomial(20, 0.1, true);
+    Check_binomial(200, 0.01, true);
+    // BTRD, the table is not used for large means
+    Check_binomial(1000, 0.3, false);
+    Check_binomial(1000, 0.3, true);
+    // probabilities above 0.5 are drawn for the complement
+    Check_binomial(30, 0.9, false);
+    Check_binomial(400, 0.8, false);
+    Check_table_agreement(20, 0.1);
+    Check_table_agreement(60, 0.15);
+    Check_trinomial();
+
+    if (failures > 0)
+    {
+        fmt::print("{} checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
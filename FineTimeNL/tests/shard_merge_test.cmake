@@ -0,0 +1,52 @@
+# Runs sweeps with main --shard i/N, merges the shard outputs with merge_shards and requires the merged files to be
+# byte identical to those of the unsharded run with --sorted.
+#   cmake -DMAIN=<main> -DMERGE=<merge_shards> -DWORK_DIR=<folder> -P shard_merge_test.cmake
+
+function(run_checked)
+    execute_process(COMMAND ${ARGV} RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${ARGV} failed: ${error}")
+    endif()
+endfunction()
+
+# case_name: folder of the case, shards: number of shards, outputs: files compared, remaining arguments: main options
+function(check_merge case_name shards outputs)
+    set(options ${ARGN})
+    set(case_dir ${WORK_DIR}/${case_name})
+    file(REMOVE_RECURSE ${case_dir})
+    file(MAKE_DIRECTORY ${case_dir}/whole ${case_dir}/shards)
+    execute_process(COMMAND ${MAIN} ${options} --sorted WORKING_DIRECTORY ${case_dir}/whole
+                    RESULT_VARIABLE result OUTPUT_QUIET)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${case_name}: unsharded run failed")
+    endif()
+
+    math(EXPR last_shard "${shards} - 1")
+    foreach(index RANGE ${last_shard})
+        execute_process(COMMAND ${MAIN} ${options} --shard ${index}/${shards} WORKING_DIRECTORY ${case_dir}/shards
+                        RESULT_VARIABLE result OUTPUT_QUIET)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${case_name}: shard ${index}/${shards} failed")
+        endif()
+    endforeach()
+
+    foreach(output ${outputs})
+        string(REGEX MATCH "[^.]+$" extension ${output})
+        string(REGEX REPLACE "\\.[^.]+$" "" name ${output})
+        file(GLOB shard_files ${case_dir}/shards/${name}.shard*of${shards}.${extension})
+        run_checked(${MERGE} -o ${case_dir}/shards/${output} ${shard_files})
+        execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${case_dir}/whole/${output}
+                                ${case_dir}/shards/${output} RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${case_name}: merged ${output} differs from the unsharded run")
+        endif()
+        message(STATUS "${case_name}: ${output} merged from ${shards} shards is identical")
+    endforeach()
+endfunction()
+
+check_merge(pa 3 "pa.csv" -m pa -r 2000 -t 2)
+check_merge(entryN 4 "entryN.csv;models.csv" -m entryN --e_min 10 --e_max 60 -r 2000 -t 3 --models)
+check_merge(grid 5 "grid.ftc;distributions.csv" -m grid --pa_size 10 --pb_size 4 --e_min 10 --e_max 40 --e_size 3 -r 500
+            -t 2 --format bin --distributions)
+check_merge(grid_csv 2 "grid.csv" -m grid --pa_size 7 --pb_size 3 --e_min 5 --e_max 20 --e_size 4 -r 500 -t 4
+            --sampling stratified)